@@ -0,0 +1,189 @@
+// DirtyRenderer.cpp: Draws only the parts of the window that changed.
+//
+
+#include "DirtyRenderer.h"
+#include "SpriteBlitter.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+// Order of the sprites used to compare two frames
+bool before(const SpriteDraw& a, const SpriteDraw& b)
+{
+  return std::tie(a.sprite, a.rect.x, a.rect.y, a.rect.w, a.rect.h) <
+         std::tie(b.sprite, b.rect.x, b.rect.y, b.rect.w, b.rect.h);
+}
+
+bool intersects(const SDL_Rect& a, const SDL_Rect& b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w &&
+         a.y < b.y + b.h && b.y < a.y + a.h;
+}
+} // namespace
+
+DirtyRenderer::DirtyRenderer(int width, int height, int tileSize, float fullRedrawRatio)
+  : width(width), height(height), tileSize(tileSize), fullRedrawRatio(fullRedrawRatio)
+{
+  cols = (width + tileSize - 1) / tileSize;
+  rows = (height + tileSize - 1) / tileSize;
+  dirtyTiles.assign(cols * rows, 0);
+}
+
+bool DirtyRenderer::tiles(const SDL_Rect& rect, int& x0, int& y0, int& x1, int& y1) const
+{
+    //Nothing of it is in the window
+  if(rect.x + rect.w <= 0 || rect.y + rect.h <= 0) return false;
+  if(rect.x >= width || rect.y >= height) return false;
+
+  x0 = std::max(0, rect.x / tileSize);
+  y0 = std::max(0, rect.y / tileSize);
+  x1 = std::min(cols - 1, (rect.x + rect.w - 1) / tileSize);
+  y1 = std::min(rows - 1, (rect.y + rect.h - 1) / tileSize);
+  return true;
+}
+
+void DirtyRenderer::mark(const SDL_Rect& rect)
+{
+  int x0, y0, x1, y1;
+  if(!tiles(rect, x0, y0, x1, y1)) return;
+
+  for(int ty = y0; ty <= y1; ++ty)
+  {
+    for(int tx = x0; tx <= x1; ++tx)
+    {
+      dirtyTiles[ty * cols + tx] = 1;
+    }
+  }
+}
+
+bool DirtyRenderer::is_dirty(const SDL_Rect& rect) const
+{
+  int x0, y0, x1, y1;
+  if(!tiles(rect, x0, y0, x1, y1)) return false;
+
+  for(int ty = y0; ty <= y1; ++ty)
+  {
+    for(int tx = x0; tx <= x1; ++tx)
+    {
+      if(dirtyTiles[ty * cols + tx]) return true;
+    }
+  }
+  return false;
+}
+
+size_t DirtyRenderer::diff()
+{
+    //Walk both sorted frames together, a sprite found in both did not change
+  size_t i = 0, j = 0;
+  while(i < previous.size() || j < sorted.size())
+  {
+    if(j == sorted.size() || (i < previous.size() && before(previous[i], sorted[j])))
+    {
+      mark(previous[i++].rect);
+    }
+    else if(i == previous.size() || before(sorted[j], previous[i]))
+    {
+      mark(sorted[j++].rect);
+    }
+    else
+    {
+      ++i;
+      ++j;
+    }
+  }
+  return std::count(dirtyTiles.begin(), dirtyTiles.end(), 1);
+}
+
+void DirtyRenderer::merge()
+{
+  rects.clear();
+    //The scratch vectors keep their capacity from one frame to the next
+  openRects.clear();
+  for(int ty = 0; ty < rows; ++ty)
+  {
+    nextRects.clear();
+    size_t o = 0;
+    int tx = 0;
+    while(tx < cols)
+    {
+      if(!dirtyTiles[ty * cols + tx]) { ++tx; continue; }
+        //Horizontal run of dirty tiles
+      int start = tx;
+      while(tx < cols && dirtyTiles[ty * cols + tx]) ++tx;
+      SDL_Rect span = {start * tileSize, ty * tileSize, (tx - start) * tileSize, tileSize};
+
+        //Same columns as a rect of the row above, make it taller
+      while(o < openRects.size() && rects[openRects[o]].x < span.x) ++o;
+      if(o < openRects.size() && rects[openRects[o]].x == span.x && rects[openRects[o]].w == span.w)
+      {
+        rects[openRects[o]].h += tileSize;
+        nextRects.push_back(openRects[o]);
+      }
+      else
+      {
+        rects.push_back(span);
+        nextRects.push_back(rects.size() - 1);
+      }
+    }
+    openRects.swap(nextRects);
+  }
+
+    //Tiles on the right and bottom edges can be partly outside of the window
+  for(auto& r : rects)
+  {
+    r.w = std::min(r.w, width - r.x);
+    r.h = std::min(r.h, height - r.y);
+  }
+}
+
+void DirtyRenderer::draw(SDL_Surface* target, Uint32 background, const std::vector<SpriteDraw>& sprites)
+{
+  sorted.assign(sprites.begin(), sprites.end());
+  std::sort(sorted.begin(), sorted.end(), before);
+
+  full = invalid;
+  invalid = false;
+  if(!full)
+  {
+    std::fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+    size_t dirty = diff();
+      //Too much changed, a single full redraw is cheaper
+    full = dirty > fullRedrawRatio * dirtyTiles.size();
+  }
+  previous.swap(sorted);
+
+  if(full)
+  {
+    SDL_FillRect(target, NULL, background);
+    for(const auto& s : sprites)
+    {
+      blit_sprite(s.sprite, target, s.rect);
+    }
+    rects.clear();
+    return;
+  }
+
+  merge();
+  if(rects.empty()) return;
+
+  touching.clear();
+  for(size_t i = 0; i < sprites.size(); ++i)
+  {
+    if(is_dirty(sprites[i].rect)) touching.push_back(i);
+  }
+
+  SDL_FillRects(target, rects.data(), rects.size(), background);
+    //Every sprite touching a dirty rect is redrawn, clipped to it so the
+    //pixels around keep their order
+  for(const auto& r : rects)
+  {
+    SDL_SetClipRect(target, &r);
+    for(size_t i : touching)
+    {
+      if(!intersects(sprites[i].rect, r)) continue;
+      blit_sprite(sprites[i].sprite, target, sprites[i].rect);
+    }
+  }
+  SDL_SetClipRect(target, NULL);
+}
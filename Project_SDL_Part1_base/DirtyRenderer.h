@@ -0,0 +1,63 @@
+// DirtyRenderer.h: Draws only the parts of the window that changed.
+
+#pragma once
+
+#include <SDL.h>
+#include <vector>
+
+// A sprite blitted at a position during a frame
+struct SpriteDraw {
+  SDL_Surface* sprite;
+  SDL_Rect rect;
+};
+
+// Redraws the sprites of a frame over the previous one.
+// The sprites of the frame are compared with the ones of the last frame,
+// the tiles covered by the ones that appeared or disappeared are dirty.
+// Dirty tiles are merged in rectangles, only those are cleared, redrawn
+// and presented. Above fullRedrawRatio of dirty tiles, or after
+// invalidate(), the whole window is redrawn instead.
+class DirtyRenderer {
+private:
+  int width, height;
+  int tileSize;
+  int cols, rows;
+  float fullRedrawRatio;
+  // The next draw() has to redraw everything
+  bool invalid = true;
+  // The last draw() redrew everything
+  bool full = true;
+
+  // Sprites of the last frame, sorted
+  std::vector<SpriteDraw> previous;
+  std::vector<SpriteDraw> sorted;
+  std::vector<uint8_t> dirtyTiles;
+  // Sprites of the frame touching a dirty tile
+  std::vector<size_t> touching;
+  // Dirty area of the last draw(), what has to be presented
+  std::vector<SDL_Rect> rects;
+  // Rects of merge() still growing downwards, index in rects, from the
+  // row above and for the row below
+  std::vector<size_t> openRects, nextRects;
+
+  // Tiles covered by rect, clipped to the window
+  bool tiles(const SDL_Rect& rect, int& x0, int& y0, int& x1, int& y1) const;
+  void mark(const SDL_Rect& rect);
+  bool is_dirty(const SDL_Rect& rect) const;
+  // Marks the sprites that are only in one of the two frames
+  // Returns the number of dirty tiles
+  size_t diff();
+  // Merges the dirty tiles in as few rects as possible
+  void merge();
+public:
+  DirtyRenderer(int width, int height, int tileSize, float fullRedrawRatio);
+
+  // Draws the sprites on target over the background, in order
+  void draw(SDL_Surface* target, Uint32 background, const std::vector<SpriteDraw>& sprites);
+
+  // Rects to present after draw(), NULL when the whole window changed
+  const std::vector<SDL_Rect>* dirty_rects() const { return full ? NULL : &rects; }
+
+  // The window content is lost, the next draw() redraws everything
+  void invalidate() { invalid = true; }
+};
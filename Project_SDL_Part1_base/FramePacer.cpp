@@ -0,0 +1,125 @@
+// FramePacer.cpp: Holds the frames to a fixed rate on the performance counter.
+//
+
+#include "FramePacer.h"
+#include "Simd.h"
+#include "StreamFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+// Frames late by more than this many periods drop their deadlines
+constexpr Uint64 max_late_periods = 2;
+
+// Lets the other hyper-thread run while spinning
+inline void cpu_relax()
+{
+#ifdef SIMD_X86
+  _mm_pause();
+#endif
+}
+} // namespace
+
+FramePacer::FramePacer(double fps, size_t window)
+  : frequency((double)SDL_GetPerformanceFrequency()),
+    intervals(std::max<size_t>(window, 2), 0)
+{
+  period = (Uint64)std::llround(frequency / fps);
+    //SDL_Delay often wakes up one or two milliseconds late, start with 2
+  spin = (Uint64)(frequency * 0.002);
+  minSpin = (Uint64)(frequency * 0.0002);
+  reset();
+}
+
+void FramePacer::reset()
+{
+  lastWake = SDL_GetPerformanceCounter();
+  deadline = lastWake + period;
+}
+
+void FramePacer::wait()
+{
+  Uint64 now = SDL_GetPerformanceCounter();
+  if(now > deadline)
+  {
+    ++missedCount;
+      //Too late to catch up, start again from now instead of rushing
+      //the next frames to make up for the ones that were missed
+    if(now - deadline > max_late_periods * period)
+    {
+      Uint64 missedPeriods = (now - deadline) / period;
+      droppedCount += missedPeriods;
+      deadline += missedPeriods * period;
+    }
+  }
+  else
+  {
+      //Sleep while the deadline is further than the spin time
+    if(deadline - now > spin)
+    {
+      Uint32 ms = (Uint32)((deadline - now - spin) * 1000 / frequency);
+      if(ms > 0)
+      {
+        Uint64 before = SDL_GetPerformanceCounter();
+        SDL_Delay(ms);
+        now = SDL_GetPerformanceCounter();
+          //Spin at least as long as SDL_Delay overslept, forget slowly
+        Uint64 asked = (Uint64)(ms * frequency / 1000);
+        Uint64 over = now > before + asked ? now - before - asked : 0;
+        spin = over > spin ? over : spin - (spin - over) / 16;
+        spin = std::clamp(spin, minSpin, period);
+      }
+    }
+      //Spin the rest of the way
+    while(now < deadline)
+    {
+      cpu_relax();
+      now = SDL_GetPerformanceCounter();
+    }
+  }
+
+  ++frames;
+  intervals[next] = now - lastWake;
+  next = (next + 1) % intervals.size();
+  used = std::min(used + 1, intervals.size());
+  lastWake = now;
+  deadline += period;
+}
+
+double FramePacer::fps() const
+{
+  if(used == 0) return 0.0;
+  double total = 0.0;
+  for(size_t i = 0; i < used; ++i)
+  {
+    total += (double)intervals[i];
+  }
+  return total > 0.0 ? used * frequency / total : 0.0;
+}
+
+double FramePacer::jitter_us() const
+{
+  if(used < 2) return 0.0;
+  double mean = 0.0;
+  for(size_t i = 0; i < used; ++i)
+  {
+    mean += (double)intervals[i];
+  }
+  mean /= used;
+  double variance = 0.0;
+  for(size_t i = 0; i < used; ++i)
+  {
+    double d = (double)intervals[i] - mean;
+    variance += d * d;
+  }
+  return std::sqrt(variance / (used - 1)) * 1e6 / frequency;
+}
+
+void FramePacer::report(std::ostream& out) const
+{
+  StreamFormatGuard guard(out);
+  out << frames << " frames, " << std::fixed << std::setprecision(1) << fps() << " fps, jitter "
+      << jitter_us() << " us, " << missedCount << " missed, " << droppedCount << " dropped\n";
+}
@@ -0,0 +1,58 @@
+// FramePacer.h: Holds the frames to a fixed rate on the performance counter.
+
+#pragma once
+
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Ends every frame on a deadline one period after the previous one.
+// wait() sleeps with SDL_Delay while the deadline is far, then spins on the
+// performance counter for the last part, so a frame ends within a few
+// microseconds of its deadline instead of a whole millisecond. The spin
+// part follows how late SDL_Delay wakes up on this machine.
+// A frame that ends after its deadline is missed; when the work takes
+// longer than several periods the deadlines it passed are dropped rather
+// than caught up in a burst.
+class FramePacer {
+private:
+  double frequency;
+  // Counter ticks per frame
+  Uint64 period;
+  Uint64 deadline;
+  // Time before the deadline at which the sleep stops and the spin starts
+  Uint64 spin;
+  Uint64 minSpin;
+  Uint64 lastWake;
+
+  uint64_t frames = 0;
+  uint64_t missedCount = 0;
+  uint64_t droppedCount = 0;
+  // Last intervals between the ends of the frames, in counter ticks
+  std::vector<Uint64> intervals;
+  size_t next = 0;
+  size_t used = 0;
+public:
+  // fps: frame rate to hold, window: frames in the statistics
+  FramePacer(double fps, size_t window);
+
+  // The next deadline is one period from now
+  void reset();
+  // Waits until the deadline of the frame and sets the next one.
+  // Returns at once when the frame is already late.
+  void wait();
+
+  uint64_t frame_count() const { return frames; }
+  // Frames that ended after their deadline
+  uint64_t missed() const { return missedCount; }
+  // Deadlines skipped because the frames were too late to catch up
+  uint64_t dropped() const { return droppedCount; }
+  // Frames per second over the window
+  double fps() const;
+  // Standard deviation of the frame intervals over the window, in microseconds
+  double jitter_us() const;
+  // One line with the frame count, fps, jitter, missed and dropped frames
+  void report(std::ostream& out) const;
+};
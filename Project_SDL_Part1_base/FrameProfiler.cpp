@@ -0,0 +1,198 @@
+// FrameProfiler.cpp: Time spent in each phase of the frames.
+//
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+// Geometry of the overlay, a row of bars per phase
+constexpr int overlayX = 4;
+constexpr int overlayY = 4;
+// Width of a bar lasting the whole budget
+constexpr int overlayBudgetWidth = 80;
+constexpr int overlayWidth = overlayBudgetWidth + 20;
+constexpr int overlayRow = 6;
+constexpr int overlayBar = 4;
+
+// Colour of the bar of each phase
+constexpr std::array<std::array<Uint8, 3>, phase_count> phaseColors = {{
+  {80, 160, 255}, {255, 200, 0}, {200, 80, 255}, {255, 120, 160}, {0, 220, 200}, {255, 255, 255}
+}};
+} // namespace
+
+RollingHistogram::RollingHistogram(size_t window)
+  : counts(bucketCount, 0), samples(std::max<size_t>(window, 1), 0)
+{
+}
+
+int RollingHistogram::bucket(uint32_t us)
+{
+  if(us < (1u << subBits)) return us;
+    //Position of the highest bit, then the subBits bits below it
+  int shift = std::bit_width(us) - 1 - subBits;
+  return ((shift + 1) << subBits) + ((us >> shift) & ((1u << subBits) - 1));
+}
+
+uint32_t RollingHistogram::bucket_value(int b)
+{
+  if(b < (1 << subBits)) return b;
+  int shift = (b >> subBits) - 1;
+  return ((1u << subBits) + (b & ((1 << subBits) - 1))) << shift;
+}
+
+void RollingHistogram::add(uint32_t us)
+{
+    //The window is full, the oldest duration leaves the histogram
+  if(used == samples.size()) --counts[bucket(samples[next])];
+  else ++used;
+
+  samples[next] = us;
+  ++counts[bucket(us)];
+  next = (next + 1) % samples.size();
+}
+
+uint32_t RollingHistogram::percentile(double p) const
+{
+  if(used == 0) return 0;
+  size_t rank = (size_t)std::ceil(p * used);
+  if(rank == 0) rank = 1;
+
+  size_t seen = 0;
+  for(int b = 0; b < bucketCount; ++b)
+  {
+    seen += counts[b];
+    if(seen >= rank) return bucket_value(b);
+  }
+  return bucket_value(bucketCount - 1);
+}
+
+FrameProfiler::FrameProfiler(double budget, size_t window)
+  : tickUs(1e6 / (double)SDL_GetPerformanceFrequency()),
+    budgetUs((uint32_t)(budget * 1e6)),
+    phases(phase_count, RollingHistogram(window)),
+    totals(window)
+{
+}
+
+bool FrameProfiler::open_csv(const std::string& path)
+{
+  csv.open(path);
+  if(!csv) return false;
+
+  csv << "frame";
+  for(const char* name : phaseNames)
+  {
+    csv << ',' << name << "_us";
+  }
+  csv << ",total_us,overrun\n";
+  return true;
+}
+
+void FrameProfiler::begin_frame()
+{
+  current = Frame();
+  current.index = frames;
+}
+
+void FrameProfiler::add(Phase phase, Uint64 ticks)
+{
+  current.us[static_cast<size_t>(phase)] += (uint32_t)(ticks * tickUs);
+}
+
+void FrameProfiler::end_frame()
+{
+    //The total is the time spent working, the sleep of the pacing is not in it
+  for(size_t p = 0; p < phase_count; ++p)
+  {
+    phases[p].add(current.us[p]);
+    current.total += current.us[p];
+  }
+  totals.add(current.total);
+
+  bool overrun = current.total > budgetUs;
+  if(overrun)
+  {
+    ++overrunCount;
+    if(overruns.size() == keptOverruns) overruns.erase(overruns.begin());
+    overruns.push_back(current);
+  }
+
+  if(csv.is_open())
+  {
+    csv << current.index;
+    for(uint32_t us : current.us)
+    {
+      csv << ',' << us;
+    }
+    csv << ',' << current.total << ',' << (overrun ? 1 : 0) << '\n';
+  }
+  ++frames;
+}
+
+uint32_t FrameProfiler::percentile(Phase phase, double p) const
+{
+  return phases[static_cast<size_t>(phase)].percentile(p);
+}
+
+void FrameProfiler::report(std::ostream& out) const
+{
+  out << "Profile of the last " << totals.size() << " of " << frames
+      << " frames, budget " << budgetUs << " us\n";
+  out << "phase          p50 us   p95 us   p99 us\n";
+  auto line = [&out](const char* name, const RollingHistogram& h) {
+    out << std::left << std::setw(12) << name << std::right;
+    for(double p : {0.50, 0.95, 0.99})
+    {
+      out << std::setw(9) << h.percentile(p);
+    }
+    out << '\n';
+  };
+  for(size_t p = 0; p < phase_count; ++p)
+  {
+    line(phaseNames[p], phases[p]);
+  }
+  line("total", totals);
+
+  out << overrunCount << " frames over budget";
+  if(!overruns.empty()) out << ", last ones:";
+  out << '\n';
+  for(const Frame& f : overruns)
+  {
+    out << "  frame " << f.index << ": " << f.total << " us (";
+    for(size_t p = 0; p < phase_count; ++p)
+    {
+      out << (p ? " " : "") << phaseNames[p] << '=' << f.us[p];
+    }
+    out << ")\n";
+  }
+}
+
+SDL_Rect FrameProfiler::overlay_rect() const
+{
+  return {overlayX, overlayY, overlayWidth, (int)phase_count * overlayRow + 2};
+}
+
+void FrameProfiler::draw_overlay(SDL_Surface* target) const
+{
+  SDL_Rect area = overlay_rect();
+  SDL_FillRect(target, &area, SDL_MapRGB(target->format, 0, 0, 0));
+
+  for(size_t p = 0; p < phase_count; ++p)
+  {
+      //p95 as a bar, the budget is overlayBudgetWidth pixels
+    uint32_t p95 = phases[p].percentile(0.95);
+    int w = (int)std::min<uint64_t>((uint64_t)p95 * overlayBudgetWidth / std::max(budgetUs, 1u),
+                                    overlayWidth - 2);
+    SDL_Rect bar = {area.x + 1, area.y + 2 + (int)p * overlayRow, std::max(w, 1), overlayBar};
+    const auto& c = phaseColors[p];
+    SDL_FillRect(target, &bar, SDL_MapRGB(target->format, c[0], c[1], c[2]));
+  }
+
+    //The budget line, every bar crossing it blows the frame alone
+  SDL_Rect budget = {area.x + 1 + overlayBudgetWidth, area.y, 1, area.h};
+  SDL_FillRect(target, &budget, SDL_MapRGB(target->format, 255, 0, 0));
+}
@@ -0,0 +1,128 @@
+// FrameProfiler.h: Time spent in each phase of the frames.
+
+#pragma once
+
+#include <SDL.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Parts of a frame timed by the profiler
+enum class Phase : uint8_t {
+  Input,      // SDL_PollEvent and the player input
+  Move,       // movement and hunting systems
+  RemoveDead, // remove_dead_animals()
+  Breed,      // add_new_animals()
+  Draw,       // ground::draw()
+  Present,    // SDL_UpdateWindowSurface
+  Count
+};
+
+constexpr size_t phase_count = static_cast<size_t>(Phase::Count);
+
+// Names of the phases, in the order of the Phase enum, used as CSV columns
+constexpr std::array<const char*, phase_count> phaseNames = {
+  "input", "move", "remove_dead", "breed", "draw", "present"
+};
+
+// Histogram of the last `window` durations, in microseconds.
+// Buckets are 16 per power of two, so a percentile is rounded down by at
+// most 6%. Adding a duration and dropping the oldest one is O(1).
+class RollingHistogram {
+private:
+  static constexpr int subBits = 4;
+  static constexpr int bucketCount = (32 - subBits + 1) << subBits;
+
+  std::vector<uint32_t> counts;
+  // Last durations, the oldest one is overwritten
+  std::vector<uint32_t> samples;
+  size_t next = 0;
+  size_t used = 0;
+
+  static int bucket(uint32_t us);
+  // Smallest duration of bucket b
+  static uint32_t bucket_value(int b);
+public:
+  explicit RollingHistogram(size_t window);
+
+  void add(uint32_t us);
+  size_t size() const { return used; }
+  // Duration below which a fraction p of the window is, 0 when empty
+  uint32_t percentile(double p) const;
+};
+
+// Times the phases of every frame.
+// Phases are added up between begin_frame() and end_frame(); a phase can be
+// timed several times in a frame, like the steps of a fast forward. Each
+// phase and the frame total go in a rolling histogram. A frame whose phases
+// take longer than the budget is an overrun, the last ones are kept with
+// their breakdown. Every frame can also be written to a CSV file.
+class FrameProfiler {
+private:
+  struct Frame {
+    uint64_t index = 0;
+    std::array<uint32_t, phase_count> us{};
+    uint32_t total = 0;
+  };
+
+  // Microseconds per performance counter tick
+  double tickUs;
+  uint32_t budgetUs;
+
+  Frame current;
+  uint64_t frames = 0;
+  std::vector<RollingHistogram> phases;
+  RollingHistogram totals;
+
+  // Last overruns, overrunCount of them since the start
+  static constexpr size_t keptOverruns = 16;
+  std::vector<Frame> overruns;
+  uint64_t overrunCount = 0;
+
+  std::ofstream csv;
+public:
+  // budget: seconds a frame may last, window: frames in the histograms
+  FrameProfiler(double budget, size_t window);
+
+  // Writes every following frame to path, returns false if it cannot be opened
+  bool open_csv(const std::string& path);
+
+  void begin_frame();
+  // ticks of the performance counter spent in phase during this frame
+  void add(Phase phase, Uint64 ticks);
+  void end_frame();
+
+  uint64_t frame_count() const { return frames; }
+  uint64_t overrun_count() const { return overrunCount; }
+  uint32_t percentile(Phase phase, double p) const;
+
+  // p50/p95/p99 of each phase and the last overruns
+  void report(std::ostream& out) const;
+
+  // Bars of the p95 of each phase against the budget, in the top left corner
+  void draw_overlay(SDL_Surface* target) const;
+  // Part of the window covered by draw_overlay()
+  SDL_Rect overlay_rect() const;
+};
+
+// Adds the time until the end of the scope to a phase, nothing if profiler is NULL
+class ProfileScope {
+private:
+  FrameProfiler* profiler;
+  Phase phase;
+  Uint64 start;
+public:
+  ProfileScope(FrameProfiler* profiler, Phase phase)
+    : profiler(profiler), phase(phase), start(profiler ? SDL_GetPerformanceCounter() : 0) {}
+  ~ProfileScope()
+  {
+    if(profiler) profiler->add(phase, SDL_GetPerformanceCounter() - start);
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+};
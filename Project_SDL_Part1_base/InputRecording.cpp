@@ -0,0 +1,122 @@
+// InputRecording.cpp: Records the player inputs of a run and replays them.
+//
+
+#include "InputRecording.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+// File layout, in native byte order:
+// magic, version, seed, sheep, wolves, end tick, snapshot hash, number of
+// parameters and their values, then the events
+constexpr char recordingMagic[4] = {'S', 'H', 'I', 'N'};
+constexpr uint32_t recordingVersion = 2;
+// Offset of the end tick, rewritten when the recording is finished
+constexpr std::streamoff endTickOffset = 4 + 4 + 8 + 4 + 4;
+constexpr size_t eventSize = 4 + 1 + 2 + 2;
+
+template <class T>
+void write_value(std::ostream& out, const T& v)
+{
+  out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <class T>
+T read_value(const char*& p)
+{
+  T v;
+  std::memcpy(&v, p, sizeof(T));
+  p += sizeof(T);
+  return v;
+}
+} // namespace
+
+InputRecorder::InputRecorder(const std::string& path, const RecordingHeader& h)
+  : out(path, std::ios::binary | std::ios::trunc), header(h)
+{
+  if(!out)
+    throw std::runtime_error("InputRecorder: cannot write " + path);
+
+  out.write(recordingMagic, sizeof(recordingMagic));
+  write_value(out, recordingVersion);
+  write_value(out, header.seed);
+  write_value(out, header.sheep);
+  write_value(out, header.wolves);
+  write_value(out, header.endTick);
+  write_value(out, header.snapshotHash);
+  write_value(out, (uint32_t)header.params.size());
+  for(int32_t v : header.params)
+  {
+    write_value(out, v);
+  }
+}
+
+InputRecorder::~InputRecorder()
+{
+  finish(header.endTick);
+}
+
+void InputRecorder::record(const InputEvent& event)
+{
+  if(!out.is_open()) return;
+  write_value(out, event.tick);
+  write_value(out, event.kind);
+  write_value(out, event.x);
+  write_value(out, event.y);
+  header.endTick = event.tick;
+}
+
+void InputRecorder::finish(uint32_t endTick)
+{
+  if(!out.is_open()) return;
+  header.endTick = endTick;
+  out.seekp(endTickOffset);
+  write_value(out, header.endTick);
+  out.close();
+}
+
+InputReplay::InputReplay(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if(!in)
+    throw std::runtime_error("InputReplay: cannot open " + path);
+  std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  if(data.size() < (size_t)endTickOffset + 4 ||
+     std::memcmp(data.data(), recordingMagic, sizeof(recordingMagic)) != 0)
+    throw std::runtime_error("InputReplay: not a recording " + path);
+
+  const char* p = data.data() + sizeof(recordingMagic);
+  if(read_value<uint32_t>(p) != recordingVersion)
+    throw std::runtime_error("InputReplay: unsupported recording version in " + path);
+  header_.seed = read_value<uint64_t>(p);
+  header_.sheep = read_value<uint32_t>(p);
+  header_.wolves = read_value<uint32_t>(p);
+  header_.endTick = read_value<uint32_t>(p);
+
+  const char* end = data.data() + data.size();
+  if(end - p < 8 + 4)
+    throw std::runtime_error("InputReplay: truncated recording " + path);
+  header_.snapshotHash = read_value<uint64_t>(p);
+  uint32_t paramCount = read_value<uint32_t>(p);
+  if(paramCount > (size_t)(end - p) / 4)
+    throw std::runtime_error("InputReplay: truncated recording " + path);
+  header_.params.resize(paramCount);
+  for(int32_t& v : header_.params)
+  {
+    v = read_value<int32_t>(p);
+  }
+
+    //A partly written last event is ignored
+  size_t count = (data.size() - (p - data.data())) / eventSize;
+  events.resize(count);
+  for(InputEvent& e : events)
+  {
+    e.tick = read_value<uint32_t>(p);
+    e.kind = read_value<InputKind>(p);
+    e.x = read_value<int16_t>(p);
+    e.y = read_value<int16_t>(p);
+  }
+}
@@ -0,0 +1,74 @@
+// InputRecording.h: Records the player inputs of a run and replays them.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class InputKind : uint8_t {
+  Player, // arrow keys, x and y are the direction
+  Mouse   // click, x and y are the position
+};
+
+// An input given to the ground before the step of the simulation clock `tick`
+struct InputEvent {
+  uint32_t tick;
+  InputKind kind;
+  int16_t x, y;
+};
+
+// Everything needed to run the recorded world again
+struct RecordingHeader {
+  uint64_t seed = 0;
+  uint32_t sheep = 0;
+  uint32_t wolves = 0;
+  // Clock tick at which the recording ended
+  uint32_t endTick = 0;
+  // snapshot_file_hash() of the world loaded before the run, 0 for none
+  uint64_t snapshotHash = 0;
+  // Simulation parameters, in the order of paramNames
+  std::vector<int32_t> params;
+};
+
+// Writes a recording file: the header, then 9 bytes per event.
+// The file is buffered and the end tick is filled in by finish().
+class InputRecorder {
+private:
+  std::ofstream out;
+  RecordingHeader header;
+public:
+  // Throws std::runtime_error if path cannot be written
+  InputRecorder(const std::string& path, const RecordingHeader& header);
+  ~InputRecorder();
+
+  void record(const InputEvent& event);
+  // Stores the last tick and closes the file, nothing once closed
+  void finish(uint32_t endTick);
+};
+
+// A whole recording loaded in memory, its events are handed out in order
+class InputReplay {
+private:
+  RecordingHeader header_;
+  std::vector<InputEvent> events;
+  size_t next = 0;
+public:
+  // Throws std::runtime_error if path is not a recording
+  explicit InputReplay(const std::string& path);
+
+  const RecordingHeader& header() const { return header_; }
+
+  // Calls f(event) for every event of tick, in the recorded order
+  template <class F>
+  void apply(uint32_t tick, F f)
+  {
+      //Events of the ticks already gone are late, they are given now
+    while(next < events.size() && events[next].tick <= tick)
+    {
+      f(events[next++]);
+    }
+  }
+};
@@ -0,0 +1,111 @@
+// JobSystem.cpp: Pool of worker threads running parallel loops.
+//
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned threads)
+{
+  if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for(unsigned i = 0; i < threads; ++i)
+  {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for(unsigned i = 1; i < threads; ++i)
+  {
+    workers.emplace_back(&JobSystem::worker_main, this, i);
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for(auto& w : workers)
+  {
+    w.join();
+  }
+}
+
+void JobSystem::submit(Batch& batch, size_t count, size_t grain)
+{
+  size_t chunks = (count + grain - 1) / grain;
+  batch.remaining.store(chunks, std::memory_order_relaxed);
+
+    //Consecutive chunks go to the same queue, each thread starts on
+    //its own part of the range
+  size_t perQueue = (chunks + queues.size() - 1) / queues.size();
+  for(size_t q = 0; q < queues.size(); ++q)
+  {
+    size_t first = q * perQueue;
+    size_t last = std::min(chunks, first + perQueue);
+    if(first >= last) break;
+
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+    for(size_t c = first; c < last; ++c)
+    {
+      queues[q]->jobs.push_back({&batch, c * grain, std::min(count, (c + 1) * grain)});
+    }
+  }
+  queued.fetch_add(chunks, std::memory_order_release);
+
+    //Taking the lock makes sure no worker misses the wake up
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  wake.notify_all();
+}
+
+bool JobSystem::run_one(size_t self)
+{
+  Job job{nullptr, 0, 0};
+  bool found = false;
+
+    //Own queue first, from the front
+  {
+    Queue& own = *queues[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if(!own.jobs.empty())
+    {
+      job = own.jobs.front();
+      own.jobs.pop_front();
+      found = true;
+    }
+  }
+    //Then steal from the back of the others
+  for(size_t k = 1; !found && k < queues.size(); ++k)
+  {
+    Queue& victim = *queues[(self + k) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.jobs.empty())
+    {
+      job = victim.jobs.back();
+      victim.jobs.pop_back();
+      found = true;
+    }
+  }
+  if(!found) return false;
+
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  job.batch->run(job.batch->ctx, job.begin, job.end);
+    //The batch belongs to the caller, it must not be touched after this
+  job.batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+  return true;
+}
+
+void JobSystem::worker_main(size_t self)
+{
+  while(true)
+  {
+    if(run_one(self)) continue;
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    if(stopping) return;
+  }
+}
@@ -0,0 +1,91 @@
+// JobSystem.h: Pool of worker threads running parallel loops.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing thread pool.
+// parallel_for() cuts a range in chunks spread over the queues of the
+// workers, a worker whose queue is empty steals chunks from the back of the
+// other queues. The calling thread works on its own queue until the whole
+// range is done. parallel_for() must only be called from the thread that
+// owns the JobSystem, never from inside a job.
+class JobSystem {
+private:
+  // One parallel_for() call
+  struct Batch {
+    void (*run)(void* ctx, size_t begin, size_t end);
+    void* ctx;
+    std::atomic<size_t> remaining;
+  };
+  // One chunk of a batch
+  struct Job {
+    Batch* batch;
+    size_t begin, end;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  // queues[0] belongs to the calling thread, queues[i] to workers[i - 1]
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  // Idle workers sleep until jobs are queued
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<size_t> queued{0};
+  bool stopping = false;
+
+  void submit(Batch& batch, size_t count, size_t grain);
+  // Runs a job of queue self, or one stolen from another queue
+  // Returns false when there was nothing to run
+  bool run_one(size_t self);
+  void worker_main(size_t self);
+public:
+  // threads: total number of threads including the caller, 0 for one per core
+  explicit JobSystem(unsigned threads = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  unsigned size() const { return queues.size(); }
+
+  // Calls f(begin, end) on chunks of at most grain elements covering
+  // [0, count[, returns once all of them are done
+  template <class F>
+  void parallel_for(size_t count, size_t grain, F&& f)
+  {
+    if(count == 0) return;
+    if(grain == 0) grain = 1;
+    if(count <= grain || queues.size() == 1)
+    {
+      f(size_t(0), count);
+      return;
+    }
+
+    using Fn = std::remove_reference_t<F>;
+    Batch batch;
+    batch.run = [](void* ctx, size_t begin, size_t end) {
+      (*static_cast<Fn*>(ctx))(begin, end);
+    };
+    batch.ctx = const_cast<void*>(static_cast<const void*>(&f));
+    submit(batch, count, grain);
+
+      //Help the workers until the last chunk is done
+    while(batch.remaining.load(std::memory_order_acquire) > 0)
+    {
+      if(!run_one(0)) std::this_thread::yield();
+    }
+  }
+};
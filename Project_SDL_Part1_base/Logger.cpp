@@ -0,0 +1,171 @@
+// Logger.cpp: Leveled logging written by a background thread.
+//
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+constexpr std::array<const char*, 5> levelNames = {"trace", "debug", "info", "warn", "error"};
+} // namespace
+
+LogLevel log_level_from_name(std::string_view name)
+{
+  for(size_t i = 0; i < levelNames.size(); ++i)
+  {
+    if(name == levelNames[i]) return static_cast<LogLevel>(i);
+  }
+  return LogLevel::Off;
+}
+
+void LogRecord::push(std::string_view v)
+{
+  LogArg& a = args[argc++];
+  a.kind = LogArg::Text;
+  a.text = textUsed;
+    //Truncated to what is left of the buffer, always null terminated
+  size_t n = std::min(v.size(), log_text_size - 1 - textUsed);
+  std::memcpy(text + textUsed, v.data(), n);
+  text[textUsed + n] = '\0';
+  textUsed += n + (textUsed + n + 1 < log_text_size ? 1 : 0);
+}
+
+void LogRecord::write(std::ostream& out) const
+{
+  out << '[' << levelNames[static_cast<size_t>(level)] << "] ";
+  size_t next = 0;
+  for(const char* c = fmt; *c; ++c)
+  {
+    if(c[0] == '{' && c[1] == '}' && next < argc)
+    {
+      const LogArg& a = args[next++];
+      switch(a.kind)
+      {
+        case LogArg::Int: out << a.i; break;
+        case LogArg::UInt: out << a.u; break;
+        case LogArg::Float: out << a.f; break;
+        case LogArg::Char: out << a.c; break;
+        case LogArg::Bool: out << (a.b ? "true" : "false"); break;
+        case LogArg::Text: out << (text + a.text); break;
+      }
+      ++c;
+    }
+    else
+    {
+      out << *c;
+    }
+  }
+  out << '\n';
+}
+
+Logger::Logger()
+  : slots(new Slot[capacity]), out(&std::cout)
+{
+  for(size_t i = 0; i < capacity; ++i)
+  {
+    slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+  writer = std::thread(&Logger::writer_main, this);
+}
+
+Logger::~Logger()
+{
+  stopping.store(true, std::memory_order_release);
+  writer.join();
+  drain();
+
+  uint64_t lost = dropped.load(), skipped = suppressed.load();
+  if(lost || skipped)
+    *out << "[warn] " << lost << " log records dropped, " << skipped << " rate limited\n";
+  out->flush();
+}
+
+Logger& Logger::instance()
+{
+  static Logger logger;
+  return logger;
+}
+
+// Bounded multi-producer ring: a slot is free for the producer that
+// reserves position p when its sequence is p, ready for the writer when it
+// is p + 1
+Logger::Slot* Logger::reserve()
+{
+  size_t pos = head.load(std::memory_order_relaxed);
+  for(;;)
+  {
+    Slot& slot = slots[pos & (capacity - 1)];
+    size_t seq = slot.seq.load(std::memory_order_acquire);
+    if(seq == pos)
+    {
+      if(head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        return &slot;
+    }
+    else if(seq < pos)
+    {
+        //The writer is a whole ring behind
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    else
+    {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::commit(Slot* slot)
+{
+  size_t pos = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::drain()
+{
+  bool wrote = false;
+  size_t pos = tail.load(std::memory_order_relaxed);
+  for(;;)
+  {
+    Slot& slot = slots[pos & (capacity - 1)];
+    if(slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+
+    slot.record.write(*out);
+      //The slot is free again for the producer one ring later
+    slot.seq.store(pos + capacity, std::memory_order_release);
+    tail.store(++pos, std::memory_order_release);
+    wrote = true;
+  }
+  if(wrote) out->flush();
+  return wrote;
+}
+
+void Logger::writer_main()
+{
+  while(!stopping.load(std::memory_order_acquire))
+  {
+      //Nothing to write, check again a bit later
+    if(!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void Logger::flush()
+{
+  size_t target = head.load(std::memory_order_acquire);
+  while(tail.load(std::memory_order_acquire) < target)
+  {
+    std::this_thread::yield();
+  }
+}
+
+bool LogRateLimit::allow()
+{
+  int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+  int64_t start = windowStart.load(std::memory_order_relaxed);
+    //A new second starts, the count goes back to zero
+  if(now - start >= 1000 && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+    count.store(0, std::memory_order_relaxed);
+  return count.fetch_add(1, std::memory_order_relaxed) < perSecond;
+}
@@ -0,0 +1,184 @@
+// Logger.h: Leveled logging written by a background thread.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class LogLevel : uint8_t {
+  Trace,
+  Debug,
+  Info,
+  Warn,
+  Error,
+  Off
+};
+
+// Levels below this one are not compiled at all, the LOG() calls vanish.
+// Release builds define it to 2 to strip Trace and Debug.
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+constexpr LogLevel compiled_log_level = static_cast<LogLevel>(LOG_COMPILED_LEVEL);
+
+// Level from its name ("trace" ... "off"), Off if unknown
+LogLevel log_level_from_name(std::string_view name);
+
+// One argument of a log call, formatted later by the logger thread
+struct LogArg {
+  enum Kind : uint8_t { Int, UInt, Float, Char, Bool, Text };
+  Kind kind;
+  union {
+    int64_t i;
+    uint64_t u;
+    double f;
+    char c;
+    bool b;
+    uint16_t text; // offset in LogRecord::text
+  };
+};
+
+constexpr size_t max_log_args = 4;
+constexpr size_t log_text_size = 64;
+
+// A log call, the format is not applied until the record is written.
+// fmt must be a string literal, "{}" is replaced by the next argument.
+// String arguments are copied in text, truncated if they do not fit.
+struct LogRecord {
+  const char* fmt;
+  LogLevel level;
+  uint8_t argc;
+  uint16_t textUsed;
+  std::array<LogArg, max_log_args> args;
+  char text[log_text_size];
+
+  void push(int64_t v) { LogArg& a = args[argc++]; a.kind = LogArg::Int; a.i = v; }
+  void push(uint64_t v) { LogArg& a = args[argc++]; a.kind = LogArg::UInt; a.u = v; }
+  void push(double v) { LogArg& a = args[argc++]; a.kind = LogArg::Float; a.f = v; }
+  void push(char v) { LogArg& a = args[argc++]; a.kind = LogArg::Char; a.c = v; }
+  void push(bool v) { LogArg& a = args[argc++]; a.kind = LogArg::Bool; a.b = v; }
+  void push(std::string_view v);
+
+  template <class T>
+  void add(const T& v)
+  {
+    if(argc == max_log_args) return;
+    if constexpr(std::is_same_v<T, bool> || std::is_same_v<T, char>) push(v);
+    else if constexpr(std::is_floating_point_v<T>) push((double)v);
+    else if constexpr(std::is_integral_v<T> && std::is_signed_v<T>) push((int64_t)v);
+    else if constexpr(std::is_integral_v<T> || std::is_enum_v<T>) push((uint64_t)v);
+    else push(std::string_view(v));
+  }
+
+  // Applies the format to the arguments
+  void write(std::ostream& out) const;
+};
+
+// Leveled logger.
+// log() only copies the format pointer and the arguments into a lock-free
+// ring buffer, a background thread formats them and writes them out. Any
+// thread may log. When the ring is full the record is dropped and counted,
+// the game never waits for the output.
+class Logger {
+private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    LogRecord record;
+  };
+  static constexpr size_t capacity = 4096;
+
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+
+  std::atomic<LogLevel> level{LogLevel::Info};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> suppressed{0};
+
+  std::ostream* out;
+  std::atomic<bool> stopping{false};
+  std::thread writer;
+
+  Logger();
+  // Slot for a record, NULL when the ring is full
+  Slot* reserve();
+  // Hands a filled slot over to the writer
+  void commit(Slot* slot);
+  // Writes the pending records, returns false if there was none
+  bool drain();
+  void writer_main();
+public:
+  ~Logger();
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  static Logger& instance();
+
+  bool enabled(LogLevel l) const { return l >= level.load(std::memory_order_relaxed); }
+  void setLevel(LogLevel l) { level.store(l, std::memory_order_relaxed); }
+
+  template <class... Args>
+  void log(LogLevel l, const char* fmt, const Args&... args)
+  {
+    static_assert(sizeof...(Args) <= max_log_args, "Too many arguments for a log record");
+    Slot* slot = reserve();
+    if(slot == NULL) return;
+    LogRecord* r = &slot->record;
+    r->fmt = fmt;
+    r->level = l;
+    r->argc = 0;
+    r->textUsed = 0;
+    (r->add(args), ...);
+    commit(slot);
+  }
+
+  // Counts a record skipped by a rate limit
+  void suppress() { suppressed.fetch_add(1, std::memory_order_relaxed); }
+  // Returns once every record logged before is written
+  void flush();
+};
+
+// At most perSecond records per second for one call site, the others are
+// counted as suppressed
+class LogRateLimit {
+private:
+  uint32_t perSecond;
+  std::atomic<int64_t> windowStart{0};
+  std::atomic<uint32_t> count{0};
+public:
+  explicit LogRateLimit(uint32_t perSecond) : perSecond(perSecond) {}
+  bool allow();
+};
+
+// LOG(Info, "{} sheep", n): logs at LogLevel::Info if it is compiled in and enabled
+#define LOG(level, ...)                                                        \
+  do {                                                                         \
+    if constexpr(LogLevel::level >= compiled_log_level) {                      \
+      if(Logger::instance().enabled(LogLevel::level))                          \
+        Logger::instance().log(LogLevel::level, __VA_ARGS__);                  \
+    }                                                                          \
+  } while(0)
+
+// LOG_RATE(Debug, 10, ...): like LOG() but at most 10 records per second
+#define LOG_RATE(level, perSecond, ...)                                        \
+  do {                                                                         \
+    if constexpr(LogLevel::level >= compiled_log_level) {                      \
+      if(Logger::instance().enabled(LogLevel::level)) {                        \
+        static LogRateLimit logRateLimit_(perSecond);                          \
+        if(logRateLimit_.allow())                                              \
+          Logger::instance().log(LogLevel::level, __VA_ARGS__);                \
+        else                                                                   \
+          Logger::instance().suppress();                                       \
+      }                                                                        \
+    }                                                                          \
+  } while(0)
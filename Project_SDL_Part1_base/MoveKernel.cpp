@@ -0,0 +1,265 @@
+// MoveKernel.cpp: Moves whole columns of animals and bounces them off the ground boundary.
+//
+
+#include "MoveKernel.h"
+#include "Simd.h"
+
+#include <SDL.h>
+
+#include <cstdint>
+
+namespace {
+// The streams are loaded as plain 64 bit states by the SIMD kernels
+static_assert(sizeof(SplitMix64) == sizeof(uint64_t), "SplitMix64 is only its state");
+
+// Constants of SplitMix64::operator()
+constexpr uint64_t splitmixGamma = 0x9e3779b97f4a7c15ull;
+constexpr uint64_t splitmixMul1 = 0xbf58476d1ce4e5b9ull;
+constexpr uint64_t splitmixMul2 = 0x94d049bb133111ebull;
+
+// Columns of c from animal i on
+MoveColumns from(const MoveColumns& c, size_t i)
+{
+  return {c.x + i, c.y + i, c.xSpeed + i, c.ySpeed + i, c.rng + i};
+}
+
+// The reference, the other kernels give exactly the same results
+void move_scalar(const MoveColumns& c, size_t n, int speed, const BounceBox& box)
+{
+  for(size_t i = 0; i < n; ++i)
+  {
+    int& x = c.x[i];
+    int& y = c.y[i];
+    int& xSpeed = c.xSpeed[i];
+    int& ySpeed = c.ySpeed[i];
+
+    int reboundrand = random_range(c.rng[i], -speed, speed);
+      //Boundary of the ground horizontal
+    if(x >= box.maxX)
+    {
+      x = box.maxX - 2;
+      xSpeed = -xSpeed;
+      ySpeed = reboundrand;
+    }
+    else if(x <= box.minX)
+    {
+      x = box.minX + 2;
+      xSpeed = -xSpeed;
+      ySpeed = reboundrand;
+    }
+
+      //Boundary of the ground vertical
+    if(y >= box.maxY)
+    {
+      y = box.maxY - 2;
+      xSpeed = reboundrand;
+      ySpeed = -ySpeed;
+    }
+    else if(y <= box.minY)
+    {
+      y = box.minY + 2;
+      xSpeed = reboundrand;
+      ySpeed = -ySpeed;
+    }
+
+      //Set the position according to the speed
+    x += xSpeed;
+    y += ySpeed;
+  }
+}
+
+#ifdef SIMD_X86
+// mask ? b : a, lane by lane
+TARGET_SSE2 inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+// Low 64 bits of a * k in each lane, from three 32 bit products
+TARGET_SSE2 inline __m128i mul64_sse2(__m128i a, __m128i k)
+{
+  __m128i lo = _mm_mul_epu32(a, k);
+  __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), k),
+                                _mm_mul_epu32(a, _mm_srli_epi64(k, 32)));
+  return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+}
+
+// Advances the 2 streams at rng, returns the high 32 bits of their values
+// in the low half of each lane
+TARGET_SSE2 inline __m128i splitmix_sse2(SplitMix64* rng)
+{
+  __m128i* state = reinterpret_cast<__m128i*>(rng);
+  __m128i z = _mm_add_epi64(_mm_loadu_si128(state), _mm_set1_epi64x(splitmixGamma));
+  _mm_storeu_si128(state, z);
+  z = mul64_sse2(_mm_xor_si128(z, _mm_srli_epi64(z, 30)), _mm_set1_epi64x(splitmixMul1));
+  z = mul64_sse2(_mm_xor_si128(z, _mm_srli_epi64(z, 27)), _mm_set1_epi64x(splitmixMul2));
+  return _mm_srli_epi64(_mm_xor_si128(z, _mm_srli_epi64(z, 31)), 32);
+}
+
+// random_range(rng[k], min, min + range) of 4 animals
+TARGET_SSE2 inline __m128i rebound_sse2(SplitMix64* rng, __m128i range, __m128i min)
+{
+  __m128i a = _mm_srli_epi64(_mm_mul_epu32(splitmix_sse2(rng), range), 32);
+  __m128i b = _mm_srli_epi64(_mm_mul_epu32(splitmix_sse2(rng + 2), range), 32);
+  a = _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0));
+  b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0));
+  return _mm_add_epi32(min, _mm_unpacklo_epi64(a, b));
+}
+
+// Reflects 4 animals on one axis: pos against [min, max], speed reversed
+// and other set to the rebound when they touch it
+TARGET_SSE2 inline void reflect_sse2(__m128i& pos, __m128i& speed, __m128i& other, __m128i rebound,
+                                     __m128i min, __m128i max)
+{
+  const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+  __m128i high = _mm_cmpgt_epi32(pos, _mm_sub_epi32(max, one));
+    //else if, the low side only counts when the high one is not reached
+  __m128i low = _mm_andnot_si128(high, _mm_cmpgt_epi32(_mm_add_epi32(min, one), pos));
+  pos = select_sse2(high, pos, _mm_sub_epi32(max, two));
+  pos = select_sse2(low, pos, _mm_add_epi32(min, two));
+  __m128i hit = _mm_or_si128(high, low);
+  speed = select_sse2(hit, speed, _mm_sub_epi32(_mm_setzero_si128(), speed));
+  other = select_sse2(hit, other, rebound);
+}
+
+TARGET_SSE2 void move_sse2(const MoveColumns& c, size_t n, int speed, const BounceBox& box)
+{
+  const __m128i range = _mm_set1_epi64x(2 * (int64_t)speed);
+  const __m128i minSpeed = _mm_set1_epi32(-speed);
+  const __m128i minX = _mm_set1_epi32(box.minX), maxX = _mm_set1_epi32(box.maxX);
+  const __m128i minY = _mm_set1_epi32(box.minY), maxY = _mm_set1_epi32(box.maxY);
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(c.x + i));
+    __m128i y = _mm_loadu_si128((const __m128i*)(c.y + i));
+    __m128i xSpeed = _mm_loadu_si128((const __m128i*)(c.xSpeed + i));
+    __m128i ySpeed = _mm_loadu_si128((const __m128i*)(c.ySpeed + i));
+    __m128i rebound = rebound_sse2(c.rng + i, range, minSpeed);
+
+      //Horizontal first, the vertical bounce wins on a corner like in the scalar code
+    reflect_sse2(x, xSpeed, ySpeed, rebound, minX, maxX);
+    reflect_sse2(y, ySpeed, xSpeed, rebound, minY, maxY);
+
+    _mm_storeu_si128((__m128i*)(c.x + i), _mm_add_epi32(x, xSpeed));
+    _mm_storeu_si128((__m128i*)(c.y + i), _mm_add_epi32(y, ySpeed));
+    _mm_storeu_si128((__m128i*)(c.xSpeed + i), xSpeed);
+    _mm_storeu_si128((__m128i*)(c.ySpeed + i), ySpeed);
+  }
+  move_scalar(from(c, i), n - i, speed, box);
+}
+
+TARGET_AVX2 inline __m256i mul64_avx2(__m256i a, __m256i k)
+{
+  __m256i lo = _mm256_mul_epu32(a, k);
+  __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), k),
+                                   _mm256_mul_epu32(a, _mm256_srli_epi64(k, 32)));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+TARGET_AVX2 inline __m256i splitmix_avx2(SplitMix64* rng)
+{
+  __m256i* state = reinterpret_cast<__m256i*>(rng);
+  __m256i z = _mm256_add_epi64(_mm256_loadu_si256(state), _mm256_set1_epi64x(splitmixGamma));
+  _mm256_storeu_si256(state, z);
+  z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), _mm256_set1_epi64x(splitmixMul1));
+  z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), _mm256_set1_epi64x(splitmixMul2));
+  return _mm256_srli_epi64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 31)), 32);
+}
+
+// random_range(rng[k], min, min + range) of 8 animals
+TARGET_AVX2 inline __m256i rebound_avx2(SplitMix64* rng, __m256i range, __m256i min)
+{
+    //The low half of each 64 bit lane, gathered in the low 128 bits
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  __m256i a = _mm256_srli_epi64(_mm256_mul_epu32(splitmix_avx2(rng), range), 32);
+  __m256i b = _mm256_srli_epi64(_mm256_mul_epu32(splitmix_avx2(rng + 4), range), 32);
+  a = _mm256_permutevar8x32_epi32(a, even);
+  b = _mm256_permutevar8x32_epi32(b, even);
+  return _mm256_add_epi32(min, _mm256_permute2x128_si256(a, b, 0x20));
+}
+
+TARGET_AVX2 inline void reflect_avx2(__m256i& pos, __m256i& speed, __m256i& other, __m256i rebound,
+                                     __m256i min, __m256i max)
+{
+  const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+  __m256i high = _mm256_cmpgt_epi32(pos, _mm256_sub_epi32(max, one));
+  __m256i low = _mm256_andnot_si256(high, _mm256_cmpgt_epi32(_mm256_add_epi32(min, one), pos));
+  pos = _mm256_blendv_epi8(pos, _mm256_sub_epi32(max, two), high);
+  pos = _mm256_blendv_epi8(pos, _mm256_add_epi32(min, two), low);
+  __m256i hit = _mm256_or_si256(high, low);
+  speed = _mm256_blendv_epi8(speed, _mm256_sub_epi32(_mm256_setzero_si256(), speed), hit);
+  other = _mm256_blendv_epi8(other, rebound, hit);
+}
+
+TARGET_AVX2 void move_avx2(const MoveColumns& c, size_t n, int speed, const BounceBox& box)
+{
+  const __m256i range = _mm256_set1_epi64x(2 * (int64_t)speed);
+  const __m256i minSpeed = _mm256_set1_epi32(-speed);
+  const __m256i minX = _mm256_set1_epi32(box.minX), maxX = _mm256_set1_epi32(box.maxX);
+  const __m256i minY = _mm256_set1_epi32(box.minY), maxY = _mm256_set1_epi32(box.maxY);
+  size_t i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(c.x + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*)(c.y + i));
+    __m256i xSpeed = _mm256_loadu_si256((const __m256i*)(c.xSpeed + i));
+    __m256i ySpeed = _mm256_loadu_si256((const __m256i*)(c.ySpeed + i));
+    __m256i rebound = rebound_avx2(c.rng + i, range, minSpeed);
+
+    reflect_avx2(x, xSpeed, ySpeed, rebound, minX, maxX);
+    reflect_avx2(y, ySpeed, xSpeed, rebound, minY, maxY);
+
+    _mm256_storeu_si256((__m256i*)(c.x + i), _mm256_add_epi32(x, xSpeed));
+    _mm256_storeu_si256((__m256i*)(c.y + i), _mm256_add_epi32(y, ySpeed));
+    _mm256_storeu_si256((__m256i*)(c.xSpeed + i), xSpeed);
+    _mm256_storeu_si256((__m256i*)(c.ySpeed + i), ySpeed);
+  }
+  move_sse2(from(c, i), n - i, speed, box);
+}
+#endif
+
+using Kernel = MoveKernelSet;
+
+// Kernel of the best instruction set of the CPU
+Kernel pick_kernel()
+{
+#ifdef SIMD_X86
+  if(SDL_HasAVX2()) return {"avx2", move_avx2};
+  if(SDL_HasSSE2()) return {"sse2", move_sse2};
+#endif
+  return {"scalar", move_scalar};
+}
+
+const Kernel& kernel()
+{
+  static const Kernel picked = pick_kernel();
+  return picked;
+}
+} // namespace
+
+void move_bounce(const MoveColumns& c, size_t n, int speed, const BounceBox& box)
+{
+    //The SIMD rebound needs the range of random_range() in 32 bits
+  if(speed < 0)
+  {
+    move_scalar(c, n, speed, box);
+    return;
+  }
+  kernel().move(c, n, speed, box);
+}
+
+const char* move_kernel_name()
+{
+  return kernel().name;
+}
+
+std::vector<MoveKernelSet> move_kernel_sets()
+{
+  std::vector<MoveKernelSet> sets = {{"scalar", move_scalar}};
+#ifdef SIMD_X86
+  if(SDL_HasSSE2()) sets.push_back({"sse2", move_sse2});
+  if(SDL_HasAVX2()) sets.push_back({"avx2", move_avx2});
+#endif
+  return sets;
+}
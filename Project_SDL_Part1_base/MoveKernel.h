@@ -0,0 +1,41 @@
+// MoveKernel.h: Moves whole columns of animals and bounces them off the ground boundary.
+
+#pragma once
+
+#include "Random.h"
+#include <cstddef>
+#include <vector>
+
+// Columns of the animals to move, NON-OWNING, each one holds n animals
+struct MoveColumns {
+  int* x;
+  int* y;
+  int* xSpeed;
+  int* ySpeed;
+  SplitMix64* rng;
+};
+
+// Box the animals bounce in: at max or beyond, an animal is put back 2
+// pixels inside and its speed reversed, the same at min or below
+struct BounceBox {
+  int minX, minY, maxX, maxY;
+};
+
+// Moves the n animals of c one step, bouncing them off box.
+// Each animal draws a rebound in [-speed, speed[ from its own stream,
+// used on the other axis when it bounces, so every kernel gives the same
+// positions, speeds and streams as the scalar one.
+// The AVX2 or SSE2 kernel is picked once from the CPU features.
+void move_bounce(const MoveColumns& c, size_t n, int speed, const BounceBox& box);
+
+// Name of the kernel picked for this CPU: "avx2", "sse2" or "scalar"
+const char* move_kernel_name();
+
+// The kernel of one instruction set
+struct MoveKernelSet {
+  const char* name;
+  void (*move)(const MoveColumns& c, size_t n, int speed, const BounceBox& box);
+};
+
+// Every kernel this CPU can run, scalar first, for the tests comparing them
+std::vector<MoveKernelSet> move_kernel_sets();
@@ -0,0 +1,223 @@
+// NearestKernel.cpp: Finds the points closest to a position in packed coordinate arrays.
+//
+
+#include "NearestKernel.h"
+#include "Simd.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+// The points [first, n[ on top of hit, a later point only wins when strictly closer
+NearestHit nearest_tail(const int* px, const int* py, size_t first, size_t n, int x, int y,
+                        NearestHit hit)
+{
+  for(size_t k = first; k < n; ++k)
+  {
+    int dx = px[k] - x;
+    int dy = py[k] - y;
+    int dist2 = dx * dx + dy * dy;
+    if(dist2 < hit.dist2) hit = {(int)k, dist2};
+  }
+  return hit;
+}
+
+int within_tail(const int* px, const int* py, const uint32_t* id, size_t first, size_t n,
+                int x, int y, int limit2, int lowest)
+{
+  for(size_t k = first; k < n; ++k)
+  {
+    int dx = px[k] - x;
+    int dy = py[k] - y;
+    if(dx * dx + dy * dy <= limit2) lowest = std::min(lowest, (int)id[k]);
+  }
+  return lowest;
+}
+
+NearestHit nearest_scalar(const int* px, const int* py, size_t n, int x, int y)
+{
+  return nearest_tail(px, py, 0, n, x, y, {-1, INT_MAX});
+}
+
+int within_scalar(const int* px, const int* py, const uint32_t* id, size_t n,
+                  int x, int y, int limit2)
+{
+  return within_tail(px, py, id, 0, n, x, y, limit2, INT32_MAX);
+}
+
+// Best of the lanes of a SIMD kernel, the first point on equal distances
+NearestHit merge_lanes(const int* dist2, const int* pos, int lanes)
+{
+  NearestHit hit{-1, INT_MAX};
+  for(int l = 0; l < lanes; ++l)
+  {
+    if(dist2[l] < hit.dist2 || (dist2[l] == hit.dist2 && pos[l] < hit.pos))
+      hit = {pos[l], dist2[l]};
+  }
+  return hit;
+}
+
+#ifdef SIMD_X86
+// mask ? b : a, lane by lane
+TARGET_SSE2 inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+// Squared distances of 4 points to (qx, qy), SSE2 has no 32 bit low
+// multiply so each square is taken from the 64 bit products
+TARGET_SSE2 inline __m128i dist2_sse2(const int* px, const int* py, __m128i qx, __m128i qy)
+{
+  __m128i dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)px), qx);
+  __m128i dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)py), qy);
+  __m128i even = _mm_add_epi64(_mm_mul_epu32(dx, dx), _mm_mul_epu32(dy, dy));
+  dx = _mm_srli_epi64(dx, 32);
+  dy = _mm_srli_epi64(dy, 32);
+  __m128i odd = _mm_add_epi64(_mm_mul_epu32(dx, dx), _mm_mul_epu32(dy, dy));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+TARGET_SSE2 NearestHit nearest_sse2(const int* px, const int* py, size_t n, int x, int y)
+{
+  const __m128i qx = _mm_set1_epi32(x), qy = _mm_set1_epi32(y);
+  const __m128i step = _mm_set1_epi32(4);
+  __m128i pos = _mm_setr_epi32(0, 1, 2, 3);
+    //Closest point seen by each lane, the first one on equal distances
+  __m128i bestDist2 = _mm_set1_epi32(INT_MAX);
+  __m128i bestPos = _mm_set1_epi32(-1);
+  size_t k = 0;
+  for(; k + 4 <= n; k += 4)
+  {
+    __m128i dist2 = dist2_sse2(px + k, py + k, qx, qy);
+    __m128i closer = _mm_cmpgt_epi32(bestDist2, dist2);
+    bestDist2 = select_sse2(closer, bestDist2, dist2);
+    bestPos = select_sse2(closer, bestPos, pos);
+    pos = _mm_add_epi32(pos, step);
+  }
+
+  alignas(16) int laneDist2[4], lanePos[4];
+  _mm_store_si128((__m128i*)laneDist2, bestDist2);
+  _mm_store_si128((__m128i*)lanePos, bestPos);
+  return nearest_tail(px, py, k, n, x, y, merge_lanes(laneDist2, lanePos, 4));
+}
+
+TARGET_SSE2 int within_sse2(const int* px, const int* py, const uint32_t* id, size_t n,
+                            int x, int y, int limit2)
+{
+  const __m128i qx = _mm_set1_epi32(x), qy = _mm_set1_epi32(y);
+  const __m128i limit = _mm_set1_epi32(limit2);
+  const __m128i none = _mm_set1_epi32(INT32_MAX);
+  __m128i lowest = none;
+  size_t k = 0;
+  for(; k + 4 <= n; k += 4)
+  {
+    __m128i far = _mm_cmpgt_epi32(dist2_sse2(px + k, py + k, qx, qy), limit);
+    __m128i ids = select_sse2(far, _mm_loadu_si128((const __m128i*)(id + k)), none);
+    lowest = select_sse2(_mm_cmpgt_epi32(lowest, ids), lowest, ids);
+  }
+
+  alignas(16) int lanes[4];
+  _mm_store_si128((__m128i*)lanes, lowest);
+  int best = *std::min_element(lanes, lanes + 4);
+  return within_tail(px, py, id, k, n, x, y, limit2, best);
+}
+
+TARGET_AVX2 inline __m256i dist2_avx2(const int* px, const int* py, __m256i qx, __m256i qy)
+{
+  __m256i dx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)px), qx);
+  __m256i dy = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)py), qy);
+  return _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+}
+
+TARGET_AVX2 NearestHit nearest_avx2(const int* px, const int* py, size_t n, int x, int y)
+{
+  const __m256i qx = _mm256_set1_epi32(x), qy = _mm256_set1_epi32(y);
+  const __m256i step = _mm256_set1_epi32(8);
+  __m256i pos = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i bestDist2 = _mm256_set1_epi32(INT_MAX);
+  __m256i bestPos = _mm256_set1_epi32(-1);
+  size_t k = 0;
+  for(; k + 8 <= n; k += 8)
+  {
+    __m256i dist2 = dist2_avx2(px + k, py + k, qx, qy);
+    __m256i closer = _mm256_cmpgt_epi32(bestDist2, dist2);
+    bestDist2 = _mm256_blendv_epi8(bestDist2, dist2, closer);
+    bestPos = _mm256_blendv_epi8(bestPos, pos, closer);
+    pos = _mm256_add_epi32(pos, step);
+  }
+
+  alignas(32) int laneDist2[8], lanePos[8];
+  _mm256_store_si256((__m256i*)laneDist2, bestDist2);
+  _mm256_store_si256((__m256i*)lanePos, bestPos);
+  return nearest_tail(px, py, k, n, x, y, merge_lanes(laneDist2, lanePos, 8));
+}
+
+TARGET_AVX2 int within_avx2(const int* px, const int* py, const uint32_t* id, size_t n,
+                            int x, int y, int limit2)
+{
+  const __m256i qx = _mm256_set1_epi32(x), qy = _mm256_set1_epi32(y);
+  const __m256i limit = _mm256_set1_epi32(limit2);
+  const __m256i none = _mm256_set1_epi32(INT32_MAX);
+  __m256i lowest = none;
+  size_t k = 0;
+  for(; k + 8 <= n; k += 8)
+  {
+    __m256i far = _mm256_cmpgt_epi32(dist2_avx2(px + k, py + k, qx, qy), limit);
+    __m256i ids = _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(id + k)), none, far);
+    lowest = _mm256_min_epi32(lowest, ids);
+  }
+
+  alignas(32) int lanes[8];
+  _mm256_store_si256((__m256i*)lanes, lowest);
+  int best = *std::min_element(lanes, lanes + 8);
+  return within_tail(px, py, id, k, n, x, y, limit2, best);
+}
+#endif
+
+using Kernels = NearestKernelSet;
+
+// Kernels of the best instruction set of the CPU
+Kernels pick_kernels()
+{
+#ifdef SIMD_X86
+  if(SDL_HasAVX2()) return {"avx2", nearest_avx2, within_avx2};
+  if(SDL_HasSSE2()) return {"sse2", nearest_sse2, within_sse2};
+#endif
+  return {"scalar", nearest_scalar, within_scalar};
+}
+
+const Kernels& kernels()
+{
+  static const Kernels picked = pick_kernels();
+  return picked;
+}
+} // namespace
+
+NearestHit nearest_point(const int* px, const int* py, size_t n, int x, int y)
+{
+  return kernels().nearest(px, py, n, x, y);
+}
+
+int lowest_id_within(const int* px, const int* py, const uint32_t* id, size_t n,
+                     int x, int y, int limit2)
+{
+  return kernels().within(px, py, id, n, x, y, limit2);
+}
+
+const char* nearest_kernel_name()
+{
+  return kernels().name;
+}
+
+std::vector<NearestKernelSet> nearest_kernel_sets()
+{
+  std::vector<NearestKernelSet> sets = {{"scalar", nearest_scalar, within_scalar}};
+#ifdef SIMD_X86
+  if(SDL_HasSSE2()) sets.push_back({"sse2", nearest_sse2, within_sse2});
+  if(SDL_HasAVX2()) sets.push_back({"avx2", nearest_avx2, within_avx2});
+#endif
+  return sets;
+}
@@ -0,0 +1,38 @@
+// NearestKernel.h: Finds the points closest to a position in packed coordinate arrays.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Closest of a range of points
+struct NearestHit {
+  int pos;   // position in the range of the first closest point, -1 if the range is empty
+  int dist2; // squared distance to it
+};
+
+// Closest of the n points (px[k], py[k]) to (x, y), compared on the
+// squared distance without any square root.
+// The AVX2 (8 points per compare) or SSE2 (4) kernel is picked once from
+// the CPU features, every kernel returns the same hit.
+NearestHit nearest_point(const int* px, const int* py, size_t n, int x, int y);
+
+// Smallest id[k] of the n points at a squared distance of at most limit2
+// from (x, y), INT32_MAX if there is none. Ids are below INT32_MAX.
+int lowest_id_within(const int* px, const int* py, const uint32_t* id, size_t n,
+                     int x, int y, int limit2);
+
+// Name of the kernels picked for this CPU: "avx2", "sse2" or "scalar"
+const char* nearest_kernel_name();
+
+// The two kernels of one instruction set
+struct NearestKernelSet {
+  const char* name;
+  NearestHit (*nearest)(const int* px, const int* py, size_t n, int x, int y);
+  int (*within)(const int* px, const int* py, const uint32_t* id, size_t n,
+                int x, int y, int limit2);
+};
+
+// Every set this CPU can run, scalar first, for the tests comparing them
+std::vector<NearestKernelSet> nearest_kernel_sets();
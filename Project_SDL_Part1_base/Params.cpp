@@ -0,0 +1,111 @@
+// Params.cpp: Reads the tuning values of the simulation from text.
+//
+
+#include "Project_SDL1.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+// Fields of SimParams in the order of paramNames
+constexpr std::array<int SimParams::*, paramNames.size()> paramFields = {
+  &SimParams::sheepSpeed, &SimParams::wolfSpeed, &SimParams::dogSpeed,
+  &SimParams::huntDistance, &SimParams::interactDistance,
+  &SimParams::breedMs, &SimParams::starveMs, &SimParams::maxAnimals,
+  &SimParams::frameBoundary, &SimParams::breedHz
+};
+
+int SimParams::* find_param(std::string_view key)
+{
+  for(size_t i = 0; i < paramNames.size(); ++i)
+  {
+    if(paramNames[i] == key) return paramFields[i];
+  }
+  throw std::invalid_argument("Unknown parameter \"" + std::string(key) + "\"");
+}
+
+std::string_view trim(std::string_view text)
+{
+  size_t first = text.find_first_not_of(" \t\r");
+  if(first == std::string_view::npos) return {};
+  size_t last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+// Breeding and starving delays are counted in steps of the clock, whose
+// distances have to fit in 31 bits
+constexpr double maxDelayTicks = 2147483647.0;
+} // namespace
+
+void set_param(SimParams& params, std::string_view key, int value)
+{
+  params.*find_param(key) = value;
+}
+
+int get_param(const SimParams& params, std::string_view key)
+{
+  return params.*find_param(key);
+}
+
+void parse_param(SimParams& params, std::string_view assignment)
+{
+  size_t equal = assignment.find('=');
+  if(equal == std::string_view::npos)
+    throw std::invalid_argument("Expected key=value, got \"" + std::string(assignment) + "\"");
+  std::string value(trim(assignment.substr(equal + 1)));
+  size_t used = 0;
+  int v = value.empty() ? 0 : std::stoi(value, &used);
+  if(value.empty() || used != value.size())
+    throw std::invalid_argument("Bad value in \"" + std::string(assignment) + "\"");
+  set_param(params, trim(assignment.substr(0, equal)), v);
+}
+
+std::vector<int32_t> param_values(const SimParams& params)
+{
+  std::vector<int32_t> values;
+  for(int SimParams::* field : paramFields)
+  {
+    values.push_back(params.*field);
+  }
+  return values;
+}
+
+SimParams params_from_values(const std::vector<int32_t>& values)
+{
+  if(values.size() != paramFields.size())
+    throw std::invalid_argument("params_from_values(): expected " + std::to_string(paramFields.size()) +
+                                " values, got " + std::to_string(values.size()));
+  SimParams params;
+  for(size_t i = 0; i < paramFields.size(); ++i)
+  {
+    params.*paramFields[i] = values[i];
+  }
+  return params;
+}
+
+bool valid_params(const SimParams& params)
+{
+  auto delay = [](int ms) { return ms >= 0 && ms * frame_rate / 1000.0 < maxDelayTicks; };
+    //A speed of 0 would never give a random direction, a boundary too wide no room to spawn
+  return params.sheepSpeed > 0 && params.wolfSpeed > 0 && params.dogSpeed >= 0 &&
+         params.huntDistance >= 0 && params.interactDistance > 0 &&
+         delay(params.breedMs) && delay(params.starveMs) &&
+         params.maxAnimals >= 0 && params.frameBoundary >= 0 && params.breedHz > 0 &&
+         2 * params.frameBoundary + animal_size < (int)std::min(frame_width, frame_height);
+}
+
+void load_params(SimParams& params, const std::string& path)
+{
+  std::ifstream in(path);
+  if(!in)
+    throw std::runtime_error("load_params(): cannot open " + path);
+
+  std::string line;
+  while(std::getline(in, line))
+  {
+    std::string_view text = trim(std::string_view(line).substr(0, line.find('#')));
+    if(text.empty()) continue;
+    parse_param(params, text);
+  }
+}
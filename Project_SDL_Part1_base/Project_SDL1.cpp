@@ -4,17 +4,23 @@
 #include "Project_SDL1.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
 #include <numeric>
-#include <random>
 #include <string>
+#include <thread>
 
-void init() {
-  // Initialize SDL
-  if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO) < 0)
+void init(bool headless) {
+  // Initialize SDL, without any video when running headless
+  Uint32 flags = headless ? SDL_INIT_TIMER : (SDL_INIT_TIMER | SDL_INIT_VIDEO);
+  if (SDL_Init(flags) < 0)
     throw std::runtime_error("init():" + std::string(SDL_GetError()));
 
+  // No sprite is ever loaded without a window
+  if (headless)
+    return;
+
   // Initialize PNG loading
   int imgFlags = IMG_INIT_PNG;
   if (!(IMG_Init(imgFlags) & imgFlags))
@@ -28,6 +34,61 @@ namespace {
 // Its purpose is to indicate to the compiler that everything
 // inside of it is UNIQUELY used within this source file.
 
+// Pixel at alpha between a (0) and b (1)
+int lerp(int a, int b, float alpha)
+{
+  return a + (int)std::lround((b - a) * alpha);
+}
+
+// Returns -1, 0 or 1 depending on the sign of v
+int sign(int v)
+{
+  if(v > 0) return 1;
+  if(v < 0) return -1;
+  return 0;
+}
+
+// Random speed in [min, max[ on both axis, never standing still
+Vec2 random_speed(Rng& rng, int min, int max)
+{
+  Vec2 speed;
+  do {
+    speed.x = random_range(rng, min, max);
+    speed.y = random_range(rng, min, max);
+  } while(speed.x == 0 && speed.y == 0);
+  return speed;
+}
+
+// Moves the animals [begin, end[ of the pool and bounces them off the
+// ground boundary, the whole range at once with the SIMD kernel
+// Velocity is reversed with a random rebound on the other axis,
+// drawn from the animal's own random stream
+template <class P>
+void bounce(AnimalPool& pool, size_t begin, size_t end, int speed, const P& p)
+{
+  const int boundary = p.value.frameBoundary;
+  MoveColumns columns = {pool.x.data() + begin, pool.y.data() + begin,
+                         pool.xSpeed.data() + begin, pool.ySpeed.data() + begin,
+                         pool.rng.data() + begin};
+  move_bounce(columns, end - begin, speed,
+              {boundary, boundary, (int)frame_width - boundary, (int)frame_height - boundary});
+}
+
+// Adds every animal of the pool to the frame with the same pre-scaled sprite,
+// at alpha between its previous and current position
+void draw_pool(const AnimalPool& pool, SDL_Surface* sprite, float alpha, std::vector<SpriteDraw>& frame)
+{
+  SDL_Rect rect;
+  rect.w = animal_size;
+  rect.h = animal_size;
+  for(size_t i = 0; i < pool.size(); ++i)
+  {
+    rect.x = lerp(pool.prevX[i], pool.x[i], alpha);
+    rect.y = lerp(pool.prevY[i], pool.y[i], alpha);
+    frame.push_back({sprite, rect});
+  }
+}
+
 SDL_Surface* load_surface_for(const std::string& filePath,
                               SDL_Surface* window_surface_ptr) {
 
@@ -37,15 +98,13 @@ SDL_Surface* load_surface_for(const std::string& filePath,
 
   if( loaded == NULL )
   {
-    std::cout << "SDL Error: " << SDL_GetError()
-      << "Failed to load image: " << filePath << '\n';
+    LOG(Error, "SDL Error: {} Failed to load image: {}", SDL_GetError(), filePath);
   }
   else {
     SDL_Surface* optimized = SDL_ConvertSurface(loaded, window_surface_ptr->format, 0);
 
     if(optimized == NULL) {
-      std::cout << "SDL Error: " << SDL_GetError()
-        << "Failed to optimize image: " << filePath << '\n';
+      LOG(Error, "SDL Error: {} Failed to optimize image: {}", SDL_GetError(), filePath);
     }
     else
     {
@@ -58,172 +117,539 @@ SDL_Surface* load_surface_for(const std::string& filePath,
 }
 } // namespace
 
+SpriteCache::SpriteCache(SDL_Surface* window_surface_ptr)
+{
+  window_surface_ptr_ = window_surface_ptr;
+}
+
+std::shared_ptr<SDL_Surface> SpriteCache::load(const std::string& filePath, int w, int h)
+{
+    //Sprite already decoded, share it
+  auto found = sprites.find(filePath);
+  if(found != sprites.end()) return found->second;
+
+  SDL_Surface* optimized = load_surface_for(filePath, window_surface_ptr_);
+  if(optimized == NULL)
+    throw std::runtime_error("SpriteCache::load(): cannot load " + filePath);
+
+    //Scale the image once here instead of on every draw
+  SDL_Surface* scaled = optimized;
+  if(optimized->w != w || optimized->h != h)
+  {
+    scaled = SDL_CreateRGBSurfaceWithFormat(0, w, h,
+      optimized->format->BitsPerPixel, optimized->format->format);
+    if(scaled == NULL)
+    {
+      SDL_FreeSurface(optimized);
+      throw std::runtime_error("SpriteCache::load(): " + std::string(SDL_GetError()));
+    }
+      //Copy the pixels as they are, the same way they were blitted on the screen before
+    SDL_SetSurfaceBlendMode(optimized, SDL_BLENDMODE_NONE);
+    SDL_BlitScaled(optimized, NULL, scaled, NULL);
+    SDL_FreeSurface(optimized);
+  }
+
+    //The surface is freed when the last object using it is gone
+  std::shared_ptr<SDL_Surface> sprite(scaled, SDL_FreeSurface);
+  sprites[filePath] = sprite;
+  return sprite;
+}
+
+std::shared_ptr<SDL_Surface> SpriteCache::get(const std::string& filePath) const
+{
+  auto found = sprites.find(filePath);
+  if(found == sprites.end())
+    throw std::runtime_error("SpriteCache::get(): sprite not loaded " + filePath);
+  return found->second;
+}
+
 // application constructor
 // Initializes the game with a certain number of sheep and wolves
 // n_sheep: number of sheep to be added to the game
 // n_wolf: number of wolves to be added to the game
+// headless: simulate without any window, nothing is drawn
 // This function creates the main application window, and sets it's size and position
-application::application(unsigned n_sheep, unsigned n_wolf) {
-  // Creates the main window for the application, with the title "Project_SDL1"
-  window_ptr_ = SDL_CreateWindow("Project_SDL1",
-  // Sets the window to be centered on the screen
-  SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-  // Sets the width and height of the window
-  frame_width, frame_height, 0);
-  // Error handling for if the window was not created correctly
-  if(!window_ptr_) {
-    std::cout <<"Error creating window\n";
-  }
-  // Get the surface of the window
-  window_surface_ptr_ = SDL_GetWindowSurface(window_ptr_);
-  // Error handling for if the surface was not acquired correctly
-  if(!window_surface_ptr_) {
-    std::cout <<"Failed to get window surface\n";
-  }
-  // creates a unique pointer to the ground
-  gameGround = std::make_unique<ground>(window_surface_ptr_);
-  // calls the function to add player
-  gameGround->add_player();
-  // calls the function to add shepherd dog
-  gameGround->add_shepherd_dog();
-  // creates n_sheep number of sheep
-  for(int i = 0; i < n_sheep; ++i) {
-    gameGround->add_animal(0, {0,0}, true);
-  }
-  // creates n_wolf number of wolves
-  for(int i = 0; i < n_wolf; ++i) {
-    gameGround->add_animal(1, {0,0}, true);
+// seed: seed of the ground's random generator, the same seed gives the same run
+// params: tuning values of the simulation
+application::application(unsigned n_sheep, unsigned n_wolf, uint64_t seed, bool headless,
+                         const SimParams& params)
+  : window_ptr_(NULL), window_surface_ptr_(NULL), headless_(headless) {
+  if(!headless_) {
+    // Creates the main window for the application, with the title "Project_SDL1"
+    window_ptr_ = SDL_CreateWindow("Project_SDL1",
+    // Sets the window to be centered on the screen
+    SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+    // Sets the width and height of the window
+    frame_width, frame_height, 0);
+    // Error handling for if the window was not created correctly
+    if(!window_ptr_) {
+      LOG(Error, "Error creating window");
+    }
+    // Get the surface of the window
+    window_surface_ptr_ = SDL_GetWindowSurface(window_ptr_);
+    // Error handling for if the surface was not acquired correctly
+    if(!window_surface_ptr_) {
+      LOG(Error, "Failed to get window surface");
+    }
   }
+  // creates a unique pointer to the ground, a NULL surface means nothing is rendered
+  gameGround = std::make_unique<ground>(window_surface_ptr_, seed, params);
+  // adds the player, the shepherd dog and the animals
+  gameGround->populate(n_sheep, n_wolf);
 }
 
 application::~application() {
-  SDL_FreeSurface(window_surface_ptr_);
-  SDL_DestroyWindow(window_ptr_);
+  if(window_ptr_) {
+    SDL_FreeSurface(window_surface_ptr_);
+    SDL_DestroyWindow(window_ptr_);
+  }
 
   SDL_Quit();
 }
 
 
-// Main loop of the app
-int application::loop(unsigned period) {
-    //flag to check if the game is running
-  bool isRunning =  true;
-    //ticks per frame
-  unsigned int ticks_per_frame = 1000.0f / (float)frameRate;
+void application::setThreads(unsigned threads) {
+  gameGround->setJobSystem(NULL);
+  jobs.reset();
+  if(threads == 1) return;
+
+  jobs = std::make_unique<JobSystem>(threads);
+  gameGround->setJobSystem(jobs.get());
+}
+
+void application::setProfiling(const std::string& csvPath, bool overlay) {
+  profiler = std::make_unique<FrameProfiler>(frame_time, profile_window);
+  if(!csvPath.empty() && !profiler->open_csv(csvPath))
+    throw std::runtime_error("setProfiling(): cannot write " + csvPath);
+  overlay_ = overlay && !headless_;
+  gameGround->setProfiler(profiler.get());
+}
 
-  //Simulation flag to control movement
-//flag to check if the simulation is running
+void application::setRecording(const std::string& path, const RecordingHeader& header) {
+  recorder = std::make_unique<InputRecorder>(path, header);
+}
 
-  bool simulating = true;
+void application::setReplay(std::unique_ptr<InputReplay> inputs) {
+  replay = std::move(inputs);
+  headless_ = true;
+}
 
-  // Time of the first tick to measure total running time of the app
-    //get the current ticks
-  unsigned int firstTick = SDL_GetTicks();
+void application::player_input(int ix, int iy) {
+  give_input({0, InputKind::Player, (int16_t)ix, (int16_t)iy});
+}
 
-    //game loop
-  while(isRunning)
+void application::mouse_input(int x, int y) {
+  give_input({0, InputKind::Mouse, (int16_t)x, (int16_t)y});
+}
+
+void application::give_input(InputEvent e) {
+  if(!queueInputs)
   {
-      //get the performance counter
-    auto start = SDL_GetPerformanceCounter();
-      //get the current ticks
-    unsigned int startTick = SDL_GetTicks();
+    apply_input(e);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(inputMutex);
+  pendingInputs.push_back(e);
+}
+
+void application::apply_input(InputEvent e) {
+    //The ground applies it before its next step, the tick it is replayed at
+  e.tick = gameGround->getClock().tick;
+  if(recorder) recorder->record(e);
+  if(e.kind == InputKind::Player) gameGround->setPlayerInput(e.x, e.y);
+  else gameGround->setMouseInput(e.x, e.y);
+}
+
+void application::apply_queued_inputs() {
+  {
+      //The inputs wait for the next step if the main thread holds the lock
+    std::unique_lock<std::mutex> lock(inputMutex, std::try_to_lock);
+    if(!lock.owns_lock() || pendingInputs.empty()) return;
+    takenInputs.swap(pendingInputs);
+  }
+  for(const InputEvent& e : takenInputs)
+  {
+    apply_input(e);
+  }
+  takenInputs.clear();
+}
 
-      //event variable
-    SDL_Event e;
-    int mouse_x = 0, mouse_y = 0;
+bool application::poll_events() {
+    //event variable
+  SDL_Event e;
+  int mouse_x = 0, mouse_y = 0;
 
-    int ix = 0, iy = 0;
-      //check for events
-    while(SDL_PollEvent(&e))
+  int ix = 0, iy = 0;
+    //check for events
+  while(SDL_PollEvent(&e))
+  {
+    //Quit
+    if(e.type == SDL_QUIT)
     {
-      //Quit
-      if(e.type == SDL_QUIT)
-      {
-        isRunning = false;
-        break;
-      }
-        //if keydown event
-      else if(e.type == SDL_KEYDOWN)
-      {
-        switch(e.key.keysym.sym)
-        {
-          case SDLK_LEFT:
-            ix = -1; //set the vertical direction of player movement to upwards
-            break;
-          case SDLK_RIGHT:
-            ix = 1;
-            break;
-          case SDLK_DOWN:
-            iy = 1;
-            break;
-          case SDLK_UP:
-            iy = -1;
-            break;
-          default:
-            ix =0; //set the horizontal direction of player movement to 0 if no arrow key is pressed
-            iy =0; //set the vertical direction of player movement to 0 if no arrow key is pressed
-            break;
-        }
-        gameGround->setPlayerInput(ix, iy); //pass the input values of player movement to the gameGround object
-      }
-      else if(e.type == SDL_KEYUP)
+      return false;
+    }
+      //if keydown event
+    else if(e.type == SDL_KEYDOWN)
+    {
+      switch(e.key.keysym.sym)
       {
-          //set the player input to 0 when the arrow key is released
-        gameGround->setPlayerInput(0,0);
+        case SDLK_LEFT:
+          ix = -1; //set the vertical direction of player movement to upwards
+          break;
+        case SDLK_RIGHT:
+          ix = 1;
+          break;
+        case SDLK_DOWN:
+          iy = 1;
+          break;
+        case SDLK_UP:
+          iy = -1;
+          break;
+        default:
+          ix =0; //set the horizontal direction of player movement to 0 if no arrow key is pressed
+          iy =0; //set the vertical direction of player movement to 0 if no arrow key is pressed
+          break;
       }
-      else if(e.type == SDL_MOUSEBUTTONDOWN)
+      player_input(ix, iy); //pass the input values of player movement to the gameGround object
+    }
+    else if(e.type == SDL_WINDOWEVENT)
+    {
+        //The window content may be lost, repaint all of it
+      gameGround->redraw_all();
+    }
+    else if(e.type == SDL_KEYUP)
+    {
+        //set the player input to 0 when the arrow key is released
+      player_input(0,0);
+    }
+    else if(e.type == SDL_MOUSEBUTTONDOWN)
+    {
+      SDL_GetMouseState(&mouse_x, &mouse_y); //get the mouse position
+      LOG(Debug, "mouse");
+      if(e.button.button == SDL_BUTTON_LEFT)
       {
-        SDL_GetMouseState(&mouse_x, &mouse_y); //get the mouse position
-        std::cout << "mouse" << std::endl;
-        if(e.button.button == SDL_BUTTON_LEFT)
-        {
-          gameGround->setMouseInput(mouse_x, mouse_y); //pass the mouse position to the gameGround object
-          std::cout << "mouse left"  << std::endl;
-        }
+        mouse_input(mouse_x, mouse_y); //pass the mouse position to the gameGround object
+        LOG(Debug, "mouse left");
       }
     }
+  }
+  return true;
+}
+
+void application::present() {
+  ProfileScope scope(profiler.get(), Phase::Present);
+    //The overlay is drawn over the ground and presented with it every frame
+  if(overlay_) profiler->draw_overlay(window_surface_ptr_);
+
+  const std::vector<SDL_Rect>* rects = gameGround->dirty_rects();
+  if(rects == NULL)
+  {
+    SDL_UpdateWindowSurface(window_ptr_);
+    return;
+  }
+
+  presentRects.assign(rects->begin(), rects->end());
+  if(overlay_) presentRects.push_back(profiler->overlay_rect());
+  if(!presentRects.empty())
+    SDL_UpdateWindowSurfaceRects(window_ptr_, presentRects.data(), presentRects.size());
+}
+
+// Main loop of the app
+int application::loop(unsigned period) {
+  if(headless_) return loop_headless(period);
+  if(renderThread_) return loop_threaded(period);
+
+    //flag to check if the game is running
+  bool isRunning =  true;
+    //Ends the drawn frames on the frame rate
+  FramePacer pacer(frameRate, profile_window);
+
+    //The simulation advances by steps of frame_time seconds, independently
+    //of the rendering, until 'period' seconds have been simulated
+  unsigned long simFrames = (unsigned long)(period * frame_rate);
+  unsigned long simFrame = 0;
+    //Wall clock time that is not simulated yet, in seconds
+  double accumulator = 0.0;
+  const double frequency = (double)SDL_GetPerformanceFrequency();
+  Uint64 previous = SDL_GetPerformanceCounter();
+    //Number of frames not drawn in a row to catch up
+  unsigned skippedFrames = 0;
+
+  // Time at which the simulation ended, the app closes 5 seconds later
+  unsigned int endSimTick = 0;
+
+    //game loop
+  while(isRunning)
+  {
+      //get the performance counter
+    auto start = SDL_GetPerformanceCounter();
+    if(profiler) profiler->begin_frame();
+
+    isRunning = poll_events();
+      //The frame started with the input
+    if(profiler) profiler->add(Phase::Input, SDL_GetPerformanceCounter() - start);
 
     //ground loop
-    if(simulating)
+      //fastForward_ simulation steps are due per frame_time of wall clock
+    accumulator += (start - previous) / frequency * fastForward_;
+    previous = start;
+      //Never keep more late steps than can be caught up before the next draw,
+      //the simulation only slows down if the steps alone are too slow
+    double maxLate = max_frame_skip * fastForward_ * frame_time;
+    if(accumulator > maxLate) accumulator = maxLate;
+
+    while(accumulator >= frame_time && simFrame < simFrames)
     {
       gameGround->update(); //update the game state
+      accumulator -= frame_time;
+      ++simFrame;
     }
-    //Update surface
-    SDL_UpdateWindowSurface(window_ptr_);
-
-    //if frame finished early
-    auto end = SDL_GetPerformanceCounter();
-    float elapsed = (end - start) / (float) SDL_GetPerformanceFrequency() * 1000.0f;
-    SDL_Delay(std::floor(ticks_per_frame - elapsed)); // delay the frame to match the frame rate
-
-    //cap frame rate
-    unsigned int endTick = SDL_GetTicks();
-    float frameTime = (endTick - startTick) / 1000.0f;
 
     // Simulation time limit
-    if(endTick - firstTick > period * 1000) //if the time since the game started is greater than the period
+    if(simFrame >= simFrames) //if 'period' seconds have been simulated
     {
-      simulating = false;
+      accumulator = 0.0;
+      if(endSimTick == 0) endSimTick = SDL_GetTicks();
     }
 
+      //Under load the drawing is skipped so that the simulation keeps up
+    bool late = accumulator >= frame_time;
+    if(late && skippedFrames < max_frame_skip)
+    {
+      ++skippedFrames;
+    }
+    else
+    {
+      skippedFrames = 0;
+        //Draw between the last two steps, proportionally to the time not simulated yet
+      {
+        ProfileScope scope(profiler.get(), Phase::Draw);
+        gameGround->draw(std::min(1.0, accumulator / frame_time));
+      }
+      //Update surface, only the rects that changed when possible
+      present();
+
+      //if frame finished early, wait for its deadline
+      pacer.wait();
+    }
+      //Skipped frames are profiled too, only their phases count, not the delay
+    if(profiler) profiler->end_frame();
+
+    unsigned int endTick = SDL_GetTicks();
+
     // Application time limit
-    if(endTick - firstTick > (period + 5) * 1000) // if the time since the game started is greater than the period plus 5 seconds
+    if(endSimTick != 0 && endTick - endSimTick > 5 * 1000) // if the simulation ended more than 5 seconds ago
     {
 
+        //the pending logs are written before the score
+      Logger::instance().flush();
       std::cout << "SCORE: "<< gameGround->getScore() << std::endl; //print the score
 
       isRunning = false;
     }
-    //std::cout << "FPS: " << std::to_string(1.0f / frameTime) << std::endl;
   }
 
+  if(recorder) recorder->finish(gameGround->getClock().tick);
+  pacer.report(std::cout);
+  if(profiler)
+  {
+    profiler->report(std::cout);
+    gameGround->report_systems(std::cout);
+  }
+  return 0;
+}
+
+// Main loop with the simulation on a thread of its own. The simulation
+// thread steps the ground at its rate and publishes a snapshot after the
+// steps; the main thread handles the events, draws the latest snapshot
+// and presents it at the frame rate. Neither waits for the other.
+int application::loop_threaded(unsigned period) {
+  FramePacer pacer(frameRate, profile_window);
+  unsigned long simFrames = (unsigned long)(period * frame_rate);
+  const double frequency = (double)SDL_GetPerformanceFrequency();
+
+    //The steps are timed apart from the frames, by the thread running them
+  std::unique_ptr<FrameProfiler> simProfiler;
+  if(profiler)
+  {
+    simProfiler = std::make_unique<FrameProfiler>(frame_time / fastForward_, profile_window);
+    gameGround->setProfiler(simProfiler.get());
+  }
+
+    //Something to draw before the first step
+  FrameSnapshot& first = frames.write_buffer();
+  gameGround->snapshot(first);
+  first.published = SDL_GetPerformanceCounter();
+  frames.publish();
+
+  queueInputs = true;
+  std::atomic<bool> stop{false};
+    // Time at which the simulation ended, the app closes 5 seconds later
+  std::atomic<unsigned int> endSimTick{0};
+
+  std::thread simulation([&]() {
+    unsigned long simFrame = 0;
+    double accumulator = 0.0;
+    Uint64 previous = SDL_GetPerformanceCounter();
+    while(!stop.load(std::memory_order_relaxed) && simFrame < simFrames)
+    {
+      Uint64 now = SDL_GetPerformanceCounter();
+      accumulator += (now - previous) / frequency * fastForward_;
+      previous = now;
+        //Steps too slow for real time are not all caught up, the simulation slows down
+      double maxLate = max_frame_skip * fastForward_ * frame_time;
+      if(accumulator > maxLate) accumulator = maxLate;
+
+      if(accumulator < frame_time)
+      {
+          //Sleep until the next step is due
+        SDL_Delay((Uint32)((frame_time - accumulator) / fastForward_ * 1000.0));
+        continue;
+      }
+
+      while(accumulator >= frame_time && simFrame < simFrames)
+      {
+        apply_queued_inputs();
+        if(simProfiler) simProfiler->begin_frame();
+        gameGround->update();
+        if(simProfiler) simProfiler->end_frame();
+        accumulator -= frame_time;
+        ++simFrame;
+      }
+
+      FrameSnapshot& snap = frames.write_buffer();
+      gameGround->snapshot(snap);
+      snap.published = SDL_GetPerformanceCounter();
+      snap.stepSeconds = frame_time / fastForward_;
+      frames.publish();
+    }
+    if(simFrame >= simFrames) endSimTick = std::max(SDL_GetTicks(), 1u);
+  });
+
+  bool isRunning = true;
+  while(isRunning)
+  {
+    auto start = SDL_GetPerformanceCounter();
+    if(profiler) profiler->begin_frame();
+    isRunning = poll_events();
+    if(profiler) profiler->add(Phase::Input, SDL_GetPerformanceCounter() - start);
+
+      //The latest complete step, the same one again if none was published since
+    frames.update();
+    const FrameSnapshot& snap = frames.read_buffer();
+    double alpha = (start - snap.published) / frequency / snap.stepSeconds;
+    {
+      ProfileScope scope(profiler.get(), Phase::Draw);
+      gameGround->draw(snap, std::min(1.0, alpha));
+    }
+    present();
+    if(profiler) profiler->end_frame();
+    pacer.wait();
+
+    // Application time limit
+    unsigned int ended = endSimTick.load();
+    if(ended != 0 && SDL_GetTicks() - ended > 5 * 1000) // if the simulation ended more than 5 seconds ago
+    {
+        //the pending logs are written before the score
+      Logger::instance().flush();
+      std::cout << "SCORE: "<< snap.score << std::endl; //print the score
+      isRunning = false;
+    }
+  }
+
+  stop = true;
+  simulation.join();
+  queueInputs = false;
+
+  if(recorder) recorder->finish(gameGround->getClock().tick);
+  pacer.report(std::cout);
+  if(profiler)
+  {
+    gameGround->setProfiler(profiler.get());
+    profiler->report(std::cout);
+    std::cout << "Simulation steps:" << std::endl;
+    simProfiler->report(std::cout);
+    gameGround->report_systems(std::cout);
+  }
+  return 0;
+}
+
+// Runs the simulation of 'period' seconds as fast as possible,
+// with no rendering and no frame pacing, and no input unless replaying
+int application::loop_headless(unsigned period) {
+  unsigned long frames = (unsigned long)(period * frame_rate);
+    //A replay runs until the tick at which its recording ended
+  if(replay)
+  {
+    uint32_t now = gameGround->getClock().tick;
+    uint32_t end = replay->header().endTick;
+    frames = end > now ? end - now : 0;
+  }
+  for(unsigned long i = 0; i < frames; ++i)
+  {
+      //Every step is a frame for the profiler
+    if(profiler) profiler->begin_frame();
+    if(replay)
+    {
+      replay->apply(gameGround->getClock().tick, [this](const InputEvent& e) {
+        if(e.kind == InputKind::Player) gameGround->setPlayerInput(e.x, e.y);
+        else gameGround->setMouseInput(e.x, e.y);
+      });
+    }
+    gameGround->update();
+    if(profiler) profiler->end_frame();
+  }
+
+  Logger::instance().flush();
+  std::cout << "SCORE: "<< gameGround->getScore() << std::endl; //print the score
+  if(recorder) recorder->finish(gameGround->getClock().tick);
+  if(profiler)
+  {
+    profiler->report(std::cout);
+    gameGround->report_systems(std::cout);
+  }
   return 0;
 }
 
 //Ground
-ground::ground(SDL_Surface* window_surface_ptr)
+ground::ground(SDL_Surface* window_surface_ptr, uint64_t seed, const SimParams& params)
+  : params(params),
+    defaultParams(params == SimParams()),
+    systems(frame_rate),
+    rng(seed),
+    sprites(window_surface_ptr),
+    renderer(frame_width, frame_height, dirty_tile_size, full_redraw_ratio),
+    sheepGrid(frame_width, frame_height, params.interactDistance)
 {
   window_surface_ptr_ = window_surface_ptr;
+  if(!valid_params(params))
+    throw std::invalid_argument("ground: simulation parameters out of range");
+    //Timers and movement every step, the dead are removed when there are
+    //some, the sheep ready to breed are only checked breedHz times per second
+  timerSystem = systems.add("timers", frame_rate);
+  moveSystem = systems.add("move", frame_rate);
+  deathSystem = systems.add("remove_dead", SystemScheduler::on_demand);
+  breedSystem = systems.add("breed", params.breedHz);
+
+    //Every slot the ground can hold is allocated once, births reuse them
+  size_t maxAnimals = params.maxAnimals;
+  sheeps.reserve(maxAnimals);
+  wolves.reserve(maxAnimals);
+  kills.reserve(maxAnimals);
+  starveTimers.resize(maxAnimals);
+  breedTimers.resize(maxAnimals);
+  readySheep.resize(maxAnimals);
+  breeders.reserve(maxAnimals);
+  mated.reserve(maxAnimals);
+  births.reserve(maxAnimals);
+
+    //Headless, there is nothing to draw on
+  if(window_surface_ptr_ == NULL) return;
+    //Decode every sprite once, all the animals share them afterwards
+  sprites.load(sheepSpritePath, animal_size, animal_size);
+  sprites.load(wolfSpritePath, animal_size, animal_size);
+  sprites.load(dogSpritePath, animal_size, animal_size);
+  sprites.load(playerSpritePath, player_size, player_size);
 }
 
 ground::~ground()
@@ -238,90 +664,133 @@ ground::~ground()
 /// <param name="id"> Animal type 0 : sheep, 1 : wolf</param>
 void ground::add_animal(int id, Vec2 pos, bool random)
 {
-  if(allAnimals.size() >= MAX_ANIMALS) return;
+  if(animal_count() >= (size_t)params.maxAnimals) return;
+  if(id != 0 && id != 1) return;
+  AnimalPool& pool = id == 0 ? sheeps : wolves;
+  init_animal(id, pool.grow(1), pos, random);
+}
+
+void ground::add_animals(int id, const std::vector<Vec2>& positions)
+{
+  if(id != 0 && id != 1) return;
+  size_t maxAnimals = params.maxAnimals;
+  size_t room = animal_count() < maxAnimals ? maxAnimals - animal_count() : 0;
+  size_t n = std::min(positions.size(), room);
+  if(n == 0) return;
+
+    //All the columns grow once, then each slot is filled in order
+  AnimalPool& pool = id == 0 ? sheeps : wolves;
+  size_t first = pool.grow(n);
+  for(size_t k = 0; k < n; ++k)
+  {
+    init_animal(id, first + k, positions[k], false);
+  }
+}
+
+void ground::init_animal(int id, size_t i, Vec2 pos, bool random)
+{
+  const int boundary = params.frameBoundary;
     //checks if the id parameter passed to the function is 0, meaning that the animal being added is a sheep.
   if(id == 0)
   {
-//creates a new instance of the sheep class and assigns it to a shared pointer called newSheep.
-    std::shared_ptr<sheep> newSheep =
-      std::make_shared<sheep>(window_surface_ptr_, sheepSpritePath);
-      //sets the size of the newSheep object to the value of the animal_size variable.
-    newSheep->setSize(animal_size, animal_size);
-    int hw = newSheep->getWidth();
-    int hh = newSheep->getHeight();
-      
-      // These lines generate random x and y positions for the sheep within the boundaries of the frame. The positions are calculated by adding the width and height of the sheep object, the frame boundary, and a random value generated by the rand() function. The random value is calculated by taking the modulus of the result of (frame_width - frame_boundary - hw) or (frame_height - frame_boundary - hh) and adding it to the previous values.
-
-    int randomX =  hw + frame_boundary + (std::rand() % (frame_width - frame_boundary - hw));
-    int randomY = hh + frame_boundary + (std::rand() % (frame_height - frame_boundary - hh));
+      //A random number between 0 and 99 is generated, if it is less than 50 the sheep is a female
+    Tag gender = Tag::Male;
+    if(random_range(rng, 0, 100) < 50)
+    {
+      gender = Tag::Female;
+    }
+      //Breeding bursts spawn many sheep in a row, only a few are logged
+    LOG_RATE(Debug, 10, "Sheep spawned: gender->{}", gender == Tag::Female ? "female" : "male");
+
+      // These lines generate random x and y positions for the sheep within the boundaries of the frame. The positions are calculated by adding the size of the sheep, the frame boundary, and a random value drawn from the ground's generator.
+    int randomX = animal_size + boundary + random_range(rng, 0, frame_width - boundary - animal_size);
+    int randomY = animal_size + boundary + random_range(rng, 0, frame_height - boundary - animal_size);
     if(random)
-    newSheep->setPos( randomX, randomY);
-    else
-      newSheep->setPos(pos.x, pos.y);
+      pos = {randomX, randomY};
 
-    newSheep->randomizeSpeed(-sheepSpeed, sheepSpeed);
-    // adds the new sheep object to the sheeps set and the allAnimals set.
-    sheeps.insert(newSheep);
-    allAnimals.insert(newSheep);
+      // sets the new sheep in its slot of the sheep pool
+    sheeps.set(i, pos, random_speed(rng, -params.sheepSpeed, params.sheepSpeed), 0,
+               tag_bit(Tag::Sheep) | tag_bit(Tag::Prey) | tag_bit(gender), rng());
+    arm_sheep(i);
   }
   else if(id == 1)
   {
-    std::shared_ptr<wolf> newWolf = std::make_shared<wolf>(window_surface_ptr_, wolfSpritePath);
-    newWolf->setSize(animal_size, animal_size);
-    int hw = newWolf->getWidth();
-    int hh = newWolf->getHeight();
-    int randomX =  hw + frame_boundary + (std::rand() % (frame_width - frame_boundary - hw));
-    int randomY = hh + frame_boundary + (std::rand() % (frame_height - frame_boundary - hh));
-
+    int randomX = animal_size + boundary + random_range(rng, 0, frame_width - boundary - animal_size);
+    int randomY = animal_size + boundary + random_range(rng, 0, frame_height - boundary - animal_size);
     if(random)
-    newWolf->setPos(randomX, randomY);
-    else {
-      newWolf->setPos(pos.x, pos.y);
-    }
-    newWolf->randomizeSpeed(-wolfSpeed, wolfSpeed);
-    newWolf->setDog(dog);
+      pos = {randomX, randomY};
 
-    wolves.insert(newWolf);
-    allAnimals.insert(newWolf);
+    wolves.set(i, pos, random_speed(rng, -params.wolfSpeed, params.wolfSpeed), 0, tag_bit(Tag::Wolf), rng());
+    arm_wolf(i);
   }
+}
 
-    // This loop goes through all the animals in the allAnimals set and creates a preyList vector containing all the objects that have the tag "prey".
-  std::vector<std::shared_ptr<MovingObject>> preyList;
-  for(auto a : allAnimals)
+void ground::arm_wolf(size_t i)
+{
+    //Starves on the first step more than starveTicks after its last meal
+  starveTimers.resize(i + 1);
+  starveTimers.schedule(i, wolves.timer[i] + params.starveTicks() + 1);
+}
+
+void ground::arm_sheep(size_t i)
+{
+  breedTimers.resize(i + 1);
+  readySheep.resize(i + 1);
+  if(!sheeps.hasTag(i, Tag::Female)) return;
+    //Can breed again breedTicks after her last lamb
+  uint32_t deadline = sheeps.timer[i] + params.breedTicks();
+  if((int32_t)(clock.tick - deadline) >= 0) readySheep.insert(i);
+  else breedTimers.schedule(i, deadline);
+}
+
+void ground::arm_timers()
+{
+  starveTimers.reset(clock.tick);
+  breedTimers.reset(clock.tick);
+  readySheep.clear();
+  for(size_t i = 0; i < wolves.size(); ++i)
   {
-    if(a->hasTag("prey"))
-    {
-      preyList.push_back(a);
-    }
+    arm_wolf(i);
   }
-
-  //Update all the hunters for now just wolf
-    // this loop goes through all the objects in the wolves set and calls the setPreyList function on each, passing the preyList vector created in the previous loop as an argument.
-  for(auto w : wolves)
+  for(size_t i = 0; i < sheeps.size(); ++i)
   {
-    w->setPreyList(preyList);
+    arm_sheep(i);
   }
-
-
-
-
 }
 
+
 void ground::add_player()
 {
-  player = std::make_shared<Player>(window_surface_ptr_, playerSpritePath);
+  player = std::make_shared<Player>(window_surface_ptr_, sprite_for(playerSpritePath));
   player->setSize(player_size, player_size);
+  player->setBoundary(params.frameBoundary);
 
 
 }
 
 void ground::add_shepherd_dog()
 {
-  dog = std::make_shared<Dog>(window_surface_ptr_, dogSpritePath);
+  dog = std::make_shared<Dog>(window_surface_ptr_, sprite_for(dogSpritePath));
   dog->setSize(animal_size, animal_size);
+  dog->setDogSpeed(params.dogSpeed);
 
   dog->setRoundCenter(player);
-  allAnimals.insert(dog);
+}
+
+void ground::populate(unsigned n_sheep, unsigned n_wolf)
+{
+  // calls the function to add player
+  add_player();
+  // calls the function to add shepherd dog
+  add_shepherd_dog();
+  // creates n_sheep number of sheep
+  for(unsigned i = 0; i < n_sheep; ++i) {
+    add_animal(0, {0,0}, true);
+  }
+  // creates n_wolf number of wolves
+  for(unsigned i = 0; i < n_wolf; ++i) {
+    add_animal(1, {0,0}, true);
+  }
 }
  
 //This function sets the player's speed based on input from the user.
@@ -341,15 +810,16 @@ void ground::setPlayerInput(int ix, int iy)
 // based on the x and y coordinates of the mouse click.
 void ground::setMouseInput(int x, int y)
 {
+  const int boundary = params.frameBoundary;
   //Check if clicked inside playArea
-  if(x < frame_boundary ||
-     x >= frame_width-frame_boundary) return; // if the x value of the click is less than the frame boundary, return nothin.
-  if(y < frame_boundary ||
-     y >= frame_height-frame_boundary) return; //if the y value of the click is less than the frame boundary, return (do nothing)
+  if(x < boundary ||
+     x >= (int)frame_width-boundary) return; // if the x value of the click is less than the frame boundary, return nothin.
+  if(y < boundary ||
+     y >= (int)frame_height-boundary) return; //if the y value of the click is less than the frame boundary, return (do nothing)
   int dist = dog->getDistTo({x, y}); //get the distance between the dog and the point where the mouse was clicked
   if(dist < CLICK_DISTANCE && !commandingUnit) //if the distance is less than the predefined distance and the dog is not currently being commanded
   {
-    std::cout << dist << "click distance" << std::endl;
+    LOG(Debug, "{} click distance", dist);
     dog->startCommand(); //start commanding the dog
     commandingUnit = true;
   }
@@ -360,190 +830,425 @@ void ground::setMouseInput(int x, int y)
   }
 }
 
+std::shared_ptr<SDL_Surface> ground::sprite_for(const std::string& filePath) const
+{
+  if(window_surface_ptr_ == NULL) return nullptr;
+  return sprites.get(filePath);
+}
+
 /// <summary>
 /// Update the ground during each frame
 /// </summary>
 void ground::update()
 {
-    //fills the window surface with a green color (hex code 0x02AA02).
-  SDL_FillRect(window_surface_ptr_, NULL, 0x02AA02);
+    //Chosen once per step, the default values are constants in the systems
+  if(defaultParams) step(DefaultParams());
+  else step(CustomParams{params});
+}
 
-  //Set dog to round the player
-//iterates through all elements of the allAnimals container.
-  for(auto& a : allAnimals)
+template <class P>
+void ground::step(const P& p)
+{
+  systems.next_step();
   {
-    a->move();
-    a->draw();
+    ProfileScope scope(profiler, Phase::Move);
+      //Positions before this step, the drawing interpolates from them
+    sheeps.save_positions();
+    wolves.save_positions();
+    dog->savePos();
+    player->savePos();
+
+      //One more step of the simulation clock, all the rules use it instead of the wall clock
+    clock.advance();
+      //The wolves starving and the sheep done with their cooldown at this step
+    systems.run(timerSystem, clock.tick, [&]() { fire_timers(clock.tick); });
+
+      //Movement systems, the dog moves before the wolves that flee from it
+    systems.run(moveSystem, clock.tick, [&]() {
+      move_sheep(p);
+      dog->move();
+      hunt(clock.tick, p);
+      player->move();
+    });
   }
 
-  player->move();
-  player->draw();
-    
-//calls the remove_dead_animals() function. It removes any animal objects that are marked as "dead" from the allAnimals container.
-  remove_dead_animals();
+  {
+    ProfileScope scope(profiler, Phase::RemoveDead);
+      //calls the remove_dead_animals() function. It removes the animals that died during this step from the pools.
+      //Only needed on the steps where something died
+    if(!sheeps.dying.empty() || !wolves.dying.empty()) systems.request(deathSystem);
+    systems.run(deathSystem, clock.tick, [&]() { remove_dead_animals(); });
+  }
 
   //Only breed sheep for now
-  //calls the add_new_animals() function. It adds any new animal objects to the allAnimals container, if there is space for them.
-  add_new_animals();
-
-
+  //calls the add_new_animals() function. It adds any new animal objects to the pools, if there is space for them.
+  ProfileScope scope(profiler, Phase::Breed);
+  systems.run(breedSystem, clock.tick, [&]() { add_new_animals(clock.tick, p); });
+}
 
+void ground::fire_timers(uint32_t now)
+{
+    //A starving wolf dies before moving, a sheep waits for the next breeding
+  starveTimers.advance(now, [this](uint32_t i) { wolves.kill(i); });
+  breedTimers.advance(now, [this](uint32_t i) { readySheep.insert(i); });
 }
 
-    //This function is called remove_dead_animals() and its purpose is to remove any animal objects that have been marked as "dead" from the game.
-void ground::remove_dead_animals()
+// Sheep moves
+template <class P>
+void ground::move_sheep(const P& p)
 {
-   // initializing a dead variable to false and creating an empty vector of shared pointers to MovingObject called animalRm.
-    //A boolean variable to check if any animal is dead.
-  bool dead = false;
-    //A vector to store the animals that need to be removed.
-  std::vector<std::shared_ptr<MovingObject>> animalRm;
-    //Iterate through all animals in the game
-  for(auto a : allAnimals)
-  {
-      //If the animal has the "dead" tag, add it to the removal vector and set the 'dead' variable to true
-    if(a->hasTag("dead"))
-    {
-      animalRm.push_back(a);
-      dead = true;
-    }
-  }
-    //Remove all animals that are in the removal vector from the allAnimals set
-  for(auto x : animalRm)
-  {
-    allAnimals.erase(x);
-  }
+    //Every sheep only touches its own slots and its own random stream
+  parallel_for(sheeps.size(), [&](size_t begin, size_t end) {
+    bounce(sheeps, begin, end, p.value.sheepSpeed, p);
+  });
+}
 
-    //If at least one animal is deads
-  if(dead)
-  {
-      //A vector to store the wolves that need to be removed.
-    std::vector<std::shared_ptr<wolf>> wolfRm;
-      //Iterate through all wolves in the game
-    for(auto a : wolves)
+// Wolf follows nearest sheep
+// now: current step of the simulation clock
+template <class P>
+void ground::hunt(uint32_t now, const P& p)
+{
+  const int wolfSpeed = p.value.wolfSpeed;
+  Vec2 dogPos = dog->getPos();
+    //Sheep already moved this frame, the grid is the snapshot of their
+    //positions read by all the wolves while the wolves write their own slots
+  sheepGrid.build(sheeps.x, sheeps.y);
+    //Sheep killed by each wolf, -1 if none
+  kills.assign(wolves.size(), -1);
+
+  parallel_for(wolves.size(), [&](size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i)
     {
-        //If the wolf has the "dead" tag, add it to the removal vector
-      if(a->hasTag("dead"))
+      int& x = wolves.x[i];
+      int& y = wolves.y[i];
+      int& xSpeed = wolves.xSpeed[i];
+      int& ySpeed = wolves.ySpeed[i];
+
+        // The wolf did not eat in STARVE_MS milliseconds of simulation, its timer killed it
+      if(wolves.hasTag(i, Tag::Dead)) continue;
+
+        // Get the distance between the wolf and the dog in x and y axis
+      int dogdx = dogPos.x - x;
+      int dogdy = dogPos.y - y;
+        // Get the squared distance between the wolf and the dog
+      int dogDist = (dogdx * dogdx) + (dogdy * dogdy);
+        // if the distance between the wolf and the dog is less than 100 pixels
+      if(dogDist < 100 * 100)
       {
-        wolfRm.push_back(a);
+          // set the speed of the wolf in the opposite direction of the dog
+        xSpeed = -sign(dogdx) * wolfSpeed;
+        ySpeed = -sign(dogdy) * wolfSpeed;
+        x += xSpeed;
+        y += ySpeed;
+        continue;
       }
-    }
-      //Remove all wolves that are in the removal vector from the wolves setr
-    for(auto x : wolfRm)
-    {
-      wolves.erase(x);
-    }
-      //A vector to store the sheep that need to be removed.
-    std::vector<std::shared_ptr<sheep>> sheepRm;
-      //Iterate through all sheep in the game
-    for(auto a : sheeps)
-    {
-        //If the sheep has the "dead" tag, add it to the removal vector
-      if(a->hasTag("dead"))
+
+      // Dog not close
+        //If there are no prey available, move randomly within the frame boundaries
+      if(sheeps.size() == 0)
       {
-        sheepRm.push_back(a);
+        bounce(wolves, i, i + 1, wolfSpeed, p);
+        continue;
       }
-    }
 
-      //Remove all sheep that are in the removal vector from the sheeps set
-    for(auto x : sheepRm)
-    {
-      sheeps.erase(x);
-    }
-      //A vector to store the list of prey
-    std::vector<std::shared_ptr<MovingObject>> preyList;
-      //Iterate through all animals in the game
-    for(auto a : allAnimals)
-    {
-        //If the animal has the "prey" tag, add it to the prey list
-      if(a->hasTag("prey"))
+      //Find the sheep
+        //only the cells around the wolf are searched
+      GridHit hit = sheepGrid.nearest(x, y);
+      size_t nearest = hit.index;
+      int minDist = hit.dist;
+
+        // Calculate directions to nearest sheep
+      int dX = sign(sheeps.x[nearest] - x);
+      int dY = sign(sheeps.y[nearest] - y);
+
+        // checks if the sheep is not in the same position as the wolf, if so set the speed of the wolf in the direction of the sheep
+      if(dX != 0 || dY != 0)
       {
-        preyList.push_back(a);
+        xSpeed = dX * wolfSpeed;
+        ySpeed = dY * wolfSpeed;
+        x += xSpeed;
+        y += ySpeed;
+      }
+        // This line checks if the wolf is close enough to the sheep to hunt it
+      if(minDist < p.value.huntDistance)
+      {
+          //The wolf is fed, the sheep dies once all the wolves have moved
+        kills[i] = nearest;
+        wolves.timer[i] = now;
       }
     }
+  });
+
+    //Merge the deaths in the order of the wolves, whatever thread ran them
+  for(size_t i = 0; i < wolves.size(); ++i)
+  {
+    if(kills[i] < 0) continue;
+    sheeps.kill(kills[i]);
+      //The wolf ate, its starvation is pushed back
+    arm_wolf(i);
+  }
+}
+
+// Snapshot layout, every value in its native representation:
+// magic, version, endianness marker, clock tick, generator state,
+// commandingUnit, player position and speed, dog position, speed and
+// state, number of sheep and wolves, then every column of the sheep pool
+// and of the wolf pool, each one starting on 8 bytes
+void ground::save(const std::string& path) const
+{
+  SnapshotWriter out;
+    //The buffer is allocated once for the whole world
+  size_t bytes = 256;
+  auto count = [&bytes](const auto& column) { bytes += column.size() * sizeof(column[0]) + 8; };
+  sheeps.for_each_column(count);
+  wolves.for_each_column(count);
+  out.reserve(bytes);
+
+  out.put(snapshot_magic);
+  out.put(snapshot_version);
+  out.put(snapshot_endian);
+  out.put(clock.tick);
+  out.put(rng.state());
+  out.put((uint8_t)commandingUnit);
+
+  out.put(player->getPos());
+  out.put(Vec2{player->xSpeed, player->ySpeed});
+  out.put(dog->getPos());
+  out.put(Vec2{dog->xSpeed, dog->ySpeed});
+    //Field by field, the padding of DogState would write uninitialized bytes.
+    //A zero byte takes the place of the padding, the layout stays the same.
+  DogState state = dog->getState();
+  out.put(state.angle);
+  out.put(state.radius);
+  out.put(state.targetPos);
+  out.put(state.moveCommand);
+  out.put(state.commandMode);
+  out.put(state.moveBack);
+  out.put(uint8_t(0));
+
+  out.put((uint64_t)sheeps.size());
+  out.put((uint64_t)wolves.size());
+  auto column = [&out](const auto& column) { out.column(column); };
+  sheeps.for_each_column(column);
+  wolves.for_each_column(column);
+
+  out.write_file(path);
+}
+
+void ground::load(const std::string& path)
+{
+  SnapshotReader in(path);
+  if(in.get<std::array<char, 4>>() != snapshot_magic)
+    throw std::runtime_error("ground::load(): not a snapshot " + path);
+  if(in.get<uint32_t>() != snapshot_version)
+    throw std::runtime_error("ground::load(): unsupported snapshot version in " + path);
+  if(in.get<uint32_t>() != snapshot_endian)
+    throw std::runtime_error("ground::load(): snapshot saved with another endianness " + path);
+
+  clock.tick = in.get<uint32_t>();
+  rng.setState(in.get<std::array<uint64_t, 4>>());
+  commandingUnit = in.get<uint8_t>() != 0;
+
+  Vec2 pos = in.get<Vec2>();
+  Vec2 speed = in.get<Vec2>();
+  player->setPos(pos.x, pos.y);
+  player->setSpeed(speed.x, speed.y);
+  player->savePos();
+  pos = in.get<Vec2>();
+  speed = in.get<Vec2>();
+  dog->setPos(pos.x, pos.y);
+  dog->setSpeed(speed.x, speed.y);
+  dog->savePos();
+  DogState state;
+  state.angle = in.get<float>();
+  state.radius = in.get<float>();
+  state.targetPos = in.get<Vec2>();
+  state.moveCommand = in.get<uint8_t>();
+  state.commandMode = in.get<uint8_t>();
+  state.moveBack = in.get<uint8_t>();
+  in.get<uint8_t>();
+  dog->setState(state);
+
+    //Each column is copied as a block, there is no parsing per animal
+  size_t sheepCount = in.get<uint64_t>();
+  size_t wolfCount = in.get<uint64_t>();
+  sheeps.for_each_column([&](auto& column) { in.column(column, sheepCount); });
+  wolves.for_each_column([&](auto& column) { in.column(column, wolfCount); });
+  sheeps.dying.clear();
+  wolves.dying.clear();
+    //The deadlines are not saved, they follow from the timer columns
+  arm_timers();
+
+    //Nothing on the screen matches the new world
+  renderer.invalidate();
+}
 
-    //Update all the hunters for now just wolf
-    for(auto w : wolves)
+/// <summary>
+/// Render the ground on the window surface, does nothing when headless
+/// </summary>
+/// <param name="alpha"> Position between the previous step (0) and the last one (1)</param>
+void ground::draw(float alpha)
+{
+  if(window_surface_ptr_ == NULL) return;
+
+    //Sprites of this frame, in drawing order
+  frame.clear();
+  draw_animals(alpha);
+  frame.push_back({dog->getSprite(), dog->getDrawRect(alpha)});
+  frame.push_back({player->getSprite(), player->getDrawRect(alpha)});
+
+    //Only what changed since the last frame is cleared with a green color (hex code 0x02AA02) and redrawn
+  renderer.draw(window_surface_ptr_, 0x02AA02, frame);
+}
+
+void ground::snapshot(FrameSnapshot& out) const
+{
+  out.sprites.clear();
+  auto add_pool = [&out](const AnimalPool& pool, SDL_Surface* sprite) {
+    for(size_t i = 0; i < pool.size(); ++i)
     {
-      w->setPreyList(preyList);
+      out.sprites.push_back({sprite, {pool.prevX[i], pool.prevY[i], animal_size, animal_size},
+                             pool.x[i], pool.y[i]});
     }
-  }
-    //if no animal is dead
-  else
+  };
+  add_pool(sheeps, sprite_for(sheepSpritePath).get());
+  add_pool(wolves, sprite_for(wolfSpritePath).get());
+  auto add_object = [&out](const RenderedObject& object) {
+    SDL_Rect to = object.getDrawRect(1.0f);
+    out.sprites.push_back({object.getSprite(), object.getDrawRect(0.0f), to.x, to.y});
+  };
+  add_object(*dog);
+  add_object(*player);
+  out.tick = clock.tick;
+  out.score = getScore();
+}
+
+void ground::draw(const FrameSnapshot& snap, float alpha)
+{
+  if(window_surface_ptr_ == NULL) return;
+
+  frame.clear();
+  for(const SpriteMotion& m : snap.sprites)
   {
-      //do nothing and return
-    return;
+    SDL_Rect rect = m.from;
+    rect.x = lerp(m.from.x, m.toX, alpha);
+    rect.y = lerp(m.from.y, m.toY, alpha);
+    frame.push_back({m.sprite, rect});
   }
+  renderer.draw(window_surface_ptr_, 0x02AA02, frame);
+}
 
+// Draw every animal of the pools with its shared sprite
+void ground::draw_animals(float alpha)
+{
+  draw_pool(sheeps, sprites.get(sheepSpritePath).get(), alpha, frame);
+  draw_pool(wolves, sprites.get(wolfSpritePath).get(), alpha, frame);
+}
+
+    //This function is called remove_dead_animals() and its purpose is to remove any animal that died during the step from the game.
+void ground::remove_dead_animals()
+{
+    //Each pool knows its dead, removing one costs the same whatever the population.
+    //The timers of the last animal follow it to the slot it takes.
+  sheeps.remove_dead([this](size_t i, size_t last) {
+    breedTimers.cancel(i);
+    readySheep.erase(i);
+    breedTimers.move(last, i);
+    readySheep.move(last, i);
+  });
+  wolves.remove_dead([this](size_t i, size_t last) {
+    starveTimers.cancel(i);
+    starveTimers.move(last, i);
+  });
 }
 
     
-void ground::add_new_animals()
+// now: current step of the simulation clock
+template <class P>
+void ground::add_new_animals(uint32_t now, const P& p)
 {
-    //iterate over all the animals in the allAnimals set
-  for(auto a : allAnimals)
-  {
-      //nested loop to check for interaction between all pairs of animals in the allAnimals set
-    for(auto b : allAnimals)
+    //Only the females whose cooldown is over are checked
+  if(readySheep.empty()) return;
+    //The dead sheep were removed, bucket the survivors again
+  sheepGrid.build(sheeps.x, sheeps.y);
+
+    //In the order of the pool, so the lambs are born in the same order
+    //whatever order the timers fired in
+  breeders.assign(readySheep.ids().begin(), readySheep.ids().end());
+  std::sort(breeders.begin(), breeders.end());
+
+    //looks for a male sheep closer than a predefined constant "INTERACT_DISTANCE" around each of them
+    //the tags are only read here, the result is merged below
+  mated.assign(breeders.size(), 0);
+  parallel_for(breeders.size(), [&](size_t begin, size_t end) {
+    for(size_t k = begin; k < end; ++k)
     {
-        //checks if the distance between animal "a" and animal "b" is less than a predefined constant "INTERACT_DISTANCE".
-      if(a->getDistTo(b->getPos()) < INTERACT_DISTANCE &&
-         a->hasTag("female") && b->hasTag("male"))
-      {
-          //if the conditions are met, call the interact function on the animal "a" with animal "b" as the parameter
-        a->interact(b);
-      }
+      size_t a = breeders[k];
+      mated[k] = sheepGrid.find_in_radius(sheeps.x[a], sheeps.y[a], p.value.interactDistance,
+        [&](size_t b) { return sheeps.hasTag(b, Tag::Male); });
     }
-  }
+  });
 
-    //create a vector to store positions where new animals will be added
-  std::vector<std::pair<int,Vec2>> addPositions;
-    //iterate over all the animals in the allAnimals set
-  for(auto a : allAnimals)
+    //the positions where new animals will be added, the vector keeps its capacity
+  births.clear();
+  for(size_t k = 0; k < breeders.size(); ++k)
   {
-      //check if the animal has the "child" and "sheep" tags
-    if(a->hasTag("child") && a->hasTag("sheep"))
-    {
-        //remove the "child" tag
-      a->removeTag("child");
-        //store the position where the new animal will be added
-      addPositions.push_back({0, a->getPos()});
-    }
+    if(!mated[k]) continue;
+    size_t a = breeders[k];
+      //The sheep is pregnant, save the time as the last time this sheep had a child,
+      //she waits for the end of her cooldown again
+    sheeps.timer[a] = now;
+    readySheep.erase(a);
+    arm_sheep(a);
+      //store the position where the new animal will be added
+    births.push_back({sheeps.x[a], sheeps.y[a]});
   }
 
-    //iterate over the stored positions
-  for(auto v : addPositions){
-      //call the add_animal function to add the new animal at the stored position
-    add_animal(v.first, v.second);
-  }
+    //add all the lambs at once at the stored positions
+  add_animals(0, births);
 }
 
+
     /*
      This function is a member function of the Interactable class.
      It adds a new tag to the list of tags associated with the object.
      The function takes in one parameter, a string called "tag" which represents the tag to be added.
      */
-void Interactable::addTag(const std::string& tag)
+void Interactable::addTag(std::string_view tag)
 {
-    //checks if the object already has the tag
+    //Known tags are a single bit of the mask
+  Tag known = find_tag(tag);
+  if(known != Tag::Count)
+  {
+    addTag(known);
+    return;
+  }
+    // Otherwise the tag is stored by name in the set of dynamic tags
   if(!hasTag(tag))
-    // If the object does not have the tag, the function inserts the tag into the set of tags associated with the object.
-  tags.insert(tag);
+    dynamicTags.insert(std::string(tag));
 }
 
-//This function is checking if the given tag is present in the "tags" container (which can be a set or map)
-bool Interactable::hasTag(const std::string& tag)
+//This function is checking if the given tag is present in the mask, or in the dynamic tags for the unknown names
+bool Interactable::hasTag(std::string_view tag) const
 {
+  Tag known = find_tag(tag);
+  if(known != Tag::Count) return hasTag(known);
     //The find() function searches the container for an element with a key equivalent to k and returns an iterator to it if found, otherwise it returns an iterator to end().
-      //So if the find() function returns an iterator to the end of the container, that means the tag is not present
-  return tags.find(tag) != tags.end();
+  return dynamicTags.find(tag) != dynamicTags.end();
 }
 
-void Interactable::removeTag(const std::string& tag)
+void Interactable::removeTag(std::string_view tag)
 {
-  if(hasTag(tag))
+  Tag known = find_tag(tag);
+  if(known != Tag::Count)
+  {
+    removeTag(known);
+    return;
+  }
+  auto found = dynamicTags.find(tag);
+  if(found != dynamicTags.end())
   {
-    tags.erase(tag);
+    dynamicTags.erase(found);
   }
 }
 
@@ -558,15 +1263,17 @@ Interactable::~Interactable()
 
     //This function is a constructor of the "RenderedObject" class.
     //It is called when a new object of this class is created.
-RenderedObject::RenderedObject(SDL_Surface* window_surface_ptr, const std::string& textureFile) {
+RenderedObject::RenderedObject(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite) {
   window_surface_ptr_ = window_surface_ptr;
     //The pointer to the SDL_Surface object is stored in the "window_surface_ptr_" variable so it can be used later.
-  image_ptr_ = load_surface_for(textureFile, window_surface_ptr);
-
-  animalRect.w = image_ptr_->w;
-  animalRect.h = image_ptr_->h;
-  animalRect.x = 0;
-  animalRect.y = 0;
+  image_ptr_ = sprite;
+
+    //The sprite is already scaled, draw it at its own size by default
+    //There is no sprite when running headless
+  w = image_ptr_ ? image_ptr_->w : 0;
+  h = image_ptr_ ? image_ptr_->h : 0;
+  x = prevX = 0;
+  y = prevY = 0;
 }
 
 RenderedObject::~RenderedObject()
@@ -575,18 +1282,25 @@ RenderedObject::~RenderedObject()
 }
     
     //Copy the image of the object onto the window surface, using the rectangle as the destination location and scaling the image if necessary
-void RenderedObject::draw()
+SDL_Rect RenderedObject::getDrawRect(float alpha) const
 {
     //Create a rectangle to hold the position and size of the object
   SDL_Rect rect;
-    //Set the x and y position of the rectangle to the x and y position of the object
-  rect.x = x;
-  rect.y = y;
+    //Set the x and y position of the rectangle between the previous and the current position of the object
+  rect.x = lerp(prevX, x, alpha);
+  rect.y = lerp(prevY, y, alpha);
     //Set the width and height of the rectangle to the width and height of the object
   rect.w = w;
   rect.h = h;
-    //Copy the image of the object onto the window surface, using the rectangle as the destination location and scaling the image if necessary
-  SDL_BlitScaled(image_ptr_, 0, window_surface_ptr_, &rect);
+  return rect;
+}
+
+void RenderedObject::draw(float alpha)
+{
+  SDL_Rect rect = getDrawRect(alpha);
+    //Copy the image of the object onto the window surface, using the rectangle as the destination location
+    //The sprite is pre-scaled, SDL only has to scale it when the size was changed
+  blit_sprite(image_ptr_.get(), window_surface_ptr_, rect);
 }
 
 
@@ -603,8 +1317,8 @@ void RenderedObject::setSize(int w, int h)
 }
 
 
-MovingObject::MovingObject(SDL_Surface* window_surface_ptr, const std::string& textureFile)
-  : RenderedObject(window_surface_ptr, textureFile)
+MovingObject::MovingObject(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite)
+  : RenderedObject(window_surface_ptr, sprite)
 {
 
 }
@@ -626,266 +1340,78 @@ void MovingObject::setSpeed(int x, int y)
 }
 
 //Animal
-animal::animal(SDL_Surface* window_surface_ptr, const std::string& filePath)
-  : MovingObject(window_surface_ptr, filePath) {
+animal::animal(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite)
+  : MovingObject(window_surface_ptr, sprite) {
 
 }
 
 animal::~animal()
 {
-  SDL_FreeSurface(image_ptr_);
+    //The sprite is shared, it is released by its last owner
 }
 
-// Draw the respective animal
-
-    //This function is a constructor of the class sheep which is inherited from class animal
-sheep::sheep(SDL_Surface* window_surface_ptr, const std::string& filePath)
-: animal( window_surface_ptr, filePath){
-  addTag("sheep");
-
-  addTag("prey");
-    //A random number between 0 and 99 is generated, if it is less than 50, addTag function is called to add the tag "female" to the object
-  if(rand() % 100 < 50)
-  {
-    addTag("female");
-    std::cout << "Sheep spawned: gender->female" << std::endl;
-  }
-  else {
-    addTag("male");
-    std::cout << "Sheep spawned: gender->male" << std::endl;
-  }
-}
-sheep::~sheep()
+void AnimalPool::reserve(size_t n)
 {
-
+  for_each_column([n](auto& column) { column.reserve(n); });
+  dying.reserve(n);
 }
 
-
-// Sheep moves
-void sheep::move()
+size_t AnimalPool::grow(size_t n)
 {
-  //Boundary of the ground horizontal
-  //Velocity is reversed with random bounce
-  int reboundrand = -sheepSpeed + (std::rand() % (2*sheepSpeed));
-  if(x >= frame_width-frame_boundary)
-  {
-    x = frame_width-frame_boundary-2;
-    setSpeed(-xSpeed, reboundrand);
-  }
-  else if(x <= frame_boundary)
-  {
-    x = frame_boundary+2;
-    setSpeed(-xSpeed, reboundrand);
-  }
-
-  //Boundary of the ground vertical
-  // Velocity is reversed with random bounce
-  if(y >= frame_height-frame_boundary)
-  {
-    y = frame_height-frame_boundary-2;
-    setSpeed(reboundrand, -ySpeed);
-  }
-  else if(y <= frame_boundary)
-  {
-    y = frame_boundary + 2;
-    setSpeed(reboundrand, -ySpeed);
-  }
-
-  //Set the position according to the speed
-  setPos(x+xSpeed, y+ySpeed);
-
+  size_t first = size();
+    //Within the capacity the freed slots at the end are reused, no allocation
+  for_each_column([n, first](auto& column) { column.resize(first + n); });
+  return first;
 }
 
-    
-    /*
-         This function is a member function of the sheep class, which is derived from the Interactable class.
-         This function is used to simulate the sheep's ability to give birth to new sheep.
-         It does not do anything more than just adding the tag for
-     */
-void sheep::interact(std::shared_ptr<Interactable> other)
+void AnimalPool::set(size_t i, Vec2 pos, Vec2 speed, uint32_t t, TagMask m, uint64_t seed)
 {
-    //Check if the other Interactable object being interacted with is also a sheep, and that it is a male, and this sheep is female
-  if(other->hasTag("sheep") && other->hasTag("male") && hasTag("female"))
-  {
-      //Get the current time in milliseconds
-    auto now = SDL_GetTicks();
-      //Check if the time since the last time this sheep had a child is less than BREED_MS
-    if(now - lastChild < BREED_MS) return;
-      //If the conditions are met, add the "child" tag to this sheep
-    addTag("child");
-    //std::cout << "Sheep pregnant!" << std::endl;
-      //save the time of this interaction as the last time this sheep had a child
-    lastChild = now;
-  }
+  x[i] = prevX[i] = pos.x;
+  y[i] = prevY[i] = pos.y;
+  xSpeed[i] = speed.x;
+  ySpeed[i] = speed.y;
+  timer[i] = t;
+  tags[i] = m;
+  rng[i] = SplitMix64{seed};
 }
 
-
-wolf::wolf(SDL_Surface* window_surface_ptr, const std::string& filePath)
-  : animal(window_surface_ptr, filePath){
-  addTag("wolf");
+size_t AnimalPool::add(Vec2 pos, Vec2 speed, uint32_t t, TagMask m, uint64_t seed)
+{
+  size_t i = grow(1);
+  set(i, pos, speed, t, m, seed);
+  return i;
 }
 
-wolf::~wolf() {
-
+void AnimalPool::save_positions()
+{
+    //Same sizes, no allocation once the pool has grown
+  prevX.assign(x.begin(), x.end());
+  prevY.assign(y.begin(), y.end());
 }
 
-// Wolf follows nearest sheep
-void wolf::move() {
-    // Get the current time in milliseconds
-  int now = SDL_GetTicks();
-    // If the wolf has not eaten in STARVE_MS milliseconds, it dies
-  if(now - lastFood > STARVE_MS)
-  {
-    addTag("dead");
-    return;
-  }
-    // Check if the dog is created
-  if(dog == nullptr)
-  {
-    std::cout << "DOG an Wolf creation order wrong!" << std::endl;
-    return;
-  }
-    // Get the position of the dog
-  Vec2 dogPos = dog->getPos();
-    // Get the distance between the wolf and the dog in x and y axis
-  int dogdx = dogPos.x - x;
-  int dogdy = dogPos.y - y;
-    // Get the distance between the wolf and the dog
-  int dogDist = (dogdx * dogdx) + (dogdy * dogdy);
-    // Check the direction of the dog in x axis
-  if(dogdx > 0) dogdx = 1;
-  else if(dogdx < 0) dogdx = -1;
-  else dogdx = 0;
-    // Check the direction of the dog in y axis
-  if(dogdy > 0) dogdy = 1;
-  else if(dogdy < 0) dogdy = -1;
-  else dogdy = 0;
-    // if the distance between the wolf and the dog is less than 100 pixels
-  if(std::sqrt(dogDist) < 100)
-  {
-      // set the speed of the wolf in the opposite direction of the dog
-    setSpeed(-dogdx * wolfSpeed, -dogdy * wolfSpeed);
-    setPos(x+xSpeed, y+ySpeed);
-    //std::cout << "Dog close!" << std::endl;
-    return;
-  }
-
-  // Dog not close
-    //If there are no prey available, move randomly within the frame boundaries
-  if(preyList.size() == 0) {
-    //Boundary of the ground horizontal
-    //Velocity is reversed with random bounce
-      //creating a random number between -wolfSpeed and wolfSpeed. This random number will be used to set the wolf's new speed when it hits the horizontal boundaries of the frame.
-    int reboundrand = -wolfSpeed + (std::rand() % (2 * wolfSpeed));
-      //first check to see if the wolf's x position is greater than or equal to the frame's width minus the frame_boundary. If the condition is true, then the wolf is at the right edge of the frame and needs to reverse direction.
-    if(x >= frame_width-frame_boundary)
-    {
-        //sets the wolf's x position to be 2 pixels away from the right edge of the frame.
-      x = frame_width-frame_boundary-2;
-        //sets the wolf's new speed, reversing the xSpeed and using the random number generated earlier for the ySpeed.
-      setSpeed(-xSpeed, reboundrand);
-    }
-      //This is a similar check as the previous one, but for the left edge of the frame. If the wolf's x position is less than or equal to the frame_boundary, then the wolf is at the left edge of the frame and needs to reverse direction.
-    else if(x <= frame_boundary)
-    {
-      x = frame_boundary+2;
-      setSpeed(-xSpeed, reboundrand);
-    }
-
-    //Boundary of the ground vertical
-    // Velocity is reversed with random bounce
-    if(y >= frame_height-frame_boundary)
-    {
-        //This line sets the wolf's y position to be 2 pixels away from the bottom edge of the frame.
-      y = frame_height-frame_boundary-2;
-        //This line sets the wolf's new speed, using the random number generated earlier for the xSpeed and reversing the ySpeed.
-      setSpeed(reboundrand, -ySpeed);
-    }
-      //This is a similar check as the previous one, but for the left edge of the frame. If the wolf's x position is less than or equal to the frame_boundary, then the wolf is at the left edge of the frame and needs to reverse direction.
-    else if(y <= frame_boundary)
-    {
-        // sets the wolf's y position to be 2 pixels away from the bottom edge of the frame.
-      y = frame_boundary + 2;
-        //sets the wolf's new speed, using the random number generated earlier for the xSpeed and reversing the ySpeed.
-      setSpeed( reboundrand, -ySpeed);
-    }
-
-    //Set the position according to the speed
-      //this line sets the wolf's position according to its xSpeed and ySpeed.
-    setPos(x+xSpeed, y+ySpeed);
-
-    return;
-  }
-
-
-  //Find the sheep
-  //iterating through a list of prey objects (of type std::shared_ptr<MovingObject>) and finding the one that is closest to the wolf.
-  std::shared_ptr<MovingObject> nearest;
-    // T initialized to a large value, and is updated with the distance to the nearest prey (by calling getDistTo() on each prey object)
-  int minDist = 1000000; // Declare and initialize a variable minDist as 1000000
-  for(auto prey : preyList)// Iterate over the preyList and for each prey
-  {
-    int dist = getDistTo(prey->getPos());// Calculate the distance between the current prey and the wolf using the getDistTo function
-    if(minDist > dist) // If the minimum distance is greater than the distance calculated above
-    {
-      minDist = dist; // Update minDist with the current distance
-      nearest = prey; // Update nearest with the current prey
-    }
-  }
-
-  // Calculate directions to nearest sheep
-    // calculates the difference in x position between the wolf and the nearest sheep
-  int dX = nearest->getX() - x ;// + nearestSheep->getWidth();
-    // checks if the sheep is to the right of the wolf, if so set dX to 1, if to the left, set to -1, otherwise set to 0
-  if(dX > 0) dX = 1;
-  else if(dX < 0) dX = -1;
-  else dX = 0;
-    //  calculates the difference in y position between the wolf and the nearest sheep
-  int dY = nearest->getY() - y;// + nearestSheep->getHeight();
-  if(dY > 0) dY = 1;
-  else if(dY < 0) dY = -1;
-  else dY = 0;
-
-   // checks if the sheep is not in the same position as the wolf, if so set the speed of the wolf in the direction of the sheep
-  if(dX != 0 || dY != 0)
-  {
-      // This line sets the speed of the wolf in the direction of the nearest sheep
-    setSpeed(dX * wolfSpeed, dY * wolfSpeed);
-      // This line updates the position of the wolf based on its speed
-    setPos(x+xSpeed, y+ySpeed);
-
-  }
-    // This line checks if the wolf is close enough to the sheep to interact with it (hunt it)
-  if(minDist < HUNT_DISTANCE)
-  {
-      // If the wolf is close enough, it interacts with the sheep (hunt it)
-    interact(nearest);
-      // This line updates the last time the wolf ate food
-    lastFood = now;
-  }
+void AnimalPool::kill(size_t i)
+{
+    //Dying twice in the same step only counts once
+  if(hasTag(i, Tag::Dead)) return;
+  addTag(i, Tag::Dead);
+  dying.push_back(i);
 }
 
-
-void wolf::interact(std::shared_ptr<Interactable> other)
+void AnimalPool::remove(size_t i)
 {
-    //This function is checking if the interactable object passed as an argument has the tag "prey"
-  if(other->hasTag("prey"))
-  {
-      //if the interactable object does not have the tag "dead"
-    if(!other->hasTag("dead"))
-        //the tag "dead" is added to it
-    other->addTag("dead");
-  }
+    //The last animal takes the place of the removed one
+  size_t last = size() - 1;
+  for_each_column([&](auto& column) {
+    column[i] = column[last];
+    column.pop_back();
+  });
 }
 
 
-
-
-
-Player::Player(SDL_Surface* window_surface_ptr, const std::string& filePath)
-  : MovingObject(window_surface_ptr, filePath)
+Player::Player(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite)
+  : MovingObject(window_surface_ptr, sprite)
 {
-  addTag("player");
+  addTag(Tag::Player);
 }
 
  //   This function is the move() method of the Player class.
@@ -896,20 +1422,20 @@ void Player::move()
   int nx = x+xSpeed;
   int ny = y+ySpeed;
     // Check if the next x position is outside of the game boundary and if so, set it to the boundary value
-  if(nx > frame_width - frame_boundary) nx = frame_width - frame_boundary;
-  else if(nx < frame_boundary)  nx = frame_boundary;
+  if(nx > (int)frame_width - boundary) nx = frame_width - boundary;
+  else if(nx < boundary)  nx = boundary;
     // Check if the next y position is outside of the game boundary and if so, set it to the boundary value
-  if(ny > frame_height - frame_boundary) ny = frame_height - frame_boundary;
-  else if(ny < frame_boundary) ny = frame_boundary;
+  if(ny > (int)frame_height - boundary) ny = frame_height - boundary;
+  else if(ny < boundary) ny = boundary;
     // update the player's position to the calculated value
   setPos(nx, ny);
 
 }
 
-Dog::Dog(SDL_Surface* window_surface_ptr, const std::string& filePath)
-  : animal(window_surface_ptr, filePath)
+Dog::Dog(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite)
+  : animal(window_surface_ptr, sprite)
 {
-  addTag("dog");
+  addTag(Tag::Dog);
 }
 
 void Dog::move()
@@ -941,8 +1467,8 @@ void Dog::move()
     else if(dy < 0) dy = -1;
     else dy = 0;
 
-      //set the dog's speed to dx * dogSpeed and dy * dogSpeed
-    setSpeed(dx * dogSpeed, dy * dogSpeed);
+      //set the dog's speed to dx * speed and dy * speed
+    setSpeed(dx * speed, dy * speed);
       //set the dog's position to x + xSpeed and y + ySpeed
     setPos(x+xSpeed, y+ySpeed);
   }
@@ -968,10 +1494,10 @@ void Dog::move()
     else if(dy < 0) dy = -1;
     else dy = 0;
 
-    setSpeed(dx * dogSpeed, dy * dogSpeed);
+    setSpeed(dx * speed, dy * speed);
     setPos(x+xSpeed, y+ySpeed);
   }
-    //set the dog's speed to dx * dogSpeed and dy * dogSpeed
+    //set the dog's speed to dx * speed and dy * speed
   else
   {
       //set the speed of rotation
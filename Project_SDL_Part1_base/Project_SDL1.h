@@ -5,16 +5,48 @@
 
 #include <SDL.h>
 #include <SDL_image.h>
+#include "DirtyRenderer.h"
+#include "FramePacer.h"
+#include "FrameProfiler.h"
+#include "InputRecording.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "MoveKernel.h"
+#include "NearestKernel.h"
+#include "Random.h"
+#include "Snapshot.h"
+#include "SpatialGrid.h"
+#include "SpriteBlitter.h"
+#include "SystemScheduler.h"
+#include "TimerWheel.h"
+#include "TripleBuffer.h"
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 #include <set>
 #include <cmath>
+#include <cstdint>
+#include <array>
+#include <string>
+#include <string_view>
 // Defintions
 constexpr double frame_rate = 60.0; // refresh rate
 constexpr double frame_time = 1. / frame_rate;
+// Maximum number of frames not drawn in a row when the simulation is late
+constexpr unsigned max_frame_skip = 5;
+// Size of the tiles used to track the changed parts of the window
+constexpr int dirty_tile_size = 32;
+// Part of the window above which it is entirely redrawn
+constexpr float full_redraw_ratio = 0.5f;
+// Frames in the rolling histograms of the profiler, 10 seconds
+constexpr size_t profile_window = 600;
+// Number of animals per job when a system runs on several threads
+constexpr size_t parallel_grain = 1024;
 constexpr unsigned frame_width = 640; // Width of window in pixel
 constexpr unsigned frame_height = 480; // Height of window in pixel
 // Minimal distance of animals to the border
@@ -47,39 +79,177 @@ constexpr int INTERACT_DISTANCE = 20;
 constexpr int BREED_MS = 4000;
 // STARVE_MS is the time it takes for a wolf to starve after it last hunted
 constexpr int STARVE_MS = 8000;
+// Number of simulation steps lasting ms milliseconds
+constexpr uint32_t ms_to_ticks(int ms) { return (uint32_t)(ms * frame_rate / 1000.0); }
+constexpr uint32_t BREED_TICKS = ms_to_ticks(BREED_MS);
+constexpr uint32_t STARVE_TICKS = ms_to_ticks(STARVE_MS);
 // CLICK_DISTANCE is the distance within which a player's click on the screen will register as interacting with an animal.
 constexpr int CLICK_DISTANCE = 200;
+
+// Tuning values of a simulation, the constants above by default.
+// They can be changed at startup from a file or the command line, see
+// set_param(), without rebuilding.
+struct SimParams {
+  int sheepSpeed = ::sheepSpeed;
+  int wolfSpeed = ::wolfSpeed;
+  int dogSpeed = ::dogSpeed;
+  int huntDistance = HUNT_DISTANCE;
+  int interactDistance = INTERACT_DISTANCE;
+  int breedMs = BREED_MS;
+  int starveMs = STARVE_MS;
+  int maxAnimals = MAX_ANIMALS;
+  int frameBoundary = frame_boundary;
+  // Breeding checks per second of simulation, the cooldown is counted in
+  // seconds so the check does not have to run on every step
+  int breedHz = 5;
+
+  constexpr uint32_t breedTicks() const { return ms_to_ticks(breedMs); }
+  constexpr uint32_t starveTicks() const { return ms_to_ticks(starveMs); }
+  bool operator==(const SimParams&) const = default;
+};
+
+// Names of the fields of SimParams, as used by set_param()
+constexpr std::array<std::string_view, 10> paramNames = {
+  "sheepSpeed", "wolfSpeed", "dogSpeed", "huntDistance", "interactDistance",
+  "breedMs", "starveMs", "maxAnimals", "frameBoundary", "breedHz"
+};
+
+// Sets the field named key, throws std::invalid_argument for an unknown name
+void set_param(SimParams& params, std::string_view key, int value);
+// Reads the field named key, throws std::invalid_argument for an unknown name
+int get_param(const SimParams& params, std::string_view key);
+// Applies a "key=value" assignment
+void parse_param(SimParams& params, std::string_view assignment);
+// Applies every "key = value" line of a file, '#' starts a comment
+void load_params(SimParams& params, const std::string& path);
+// Values of every parameter, in the order of paramNames
+std::vector<int32_t> param_values(const SimParams& params);
+// Parameters from param_values(), throws std::invalid_argument if the
+// number of values is not the number of parameters
+SimParams params_from_values(const std::vector<int32_t>& values);
+// Whether a ground can run with params, the ground throws otherwise
+bool valid_params(const SimParams& params);
+
+// The systems of ground are templates on where they read the parameters
+// from, P::value. With DefaultParams every value is a compile-time constant
+// and the rules are folded exactly like with the constants, CustomParams
+// reads them from the SimParams of the ground.
+struct DefaultParams {
+  static constexpr SimParams value{};
+};
+struct CustomParams {
+  const SimParams& value;
+};
 // Helper function to initialize SDL
-void init();
+// headless: only the timer is initialized, no video and no image loading
+void init(bool headless = false);
 
 struct Vec2 {
   int x,y;
 };
 
+// Time of the simulation, counted in steps of frame_time seconds.
+// It only moves when the ground is updated, whatever the wall clock says.
+struct SimClock {
+  uint32_t tick = 0;
+
+  void advance() { ++tick; }
+  double seconds() const { return tick * frame_time; }
+};
+
+// Shared store of the sprites used by the game.
+// Each png is decoded only once, converted to the window format and scaled
+// to its on-screen size; every object drawing it keeps a reference to the
+// same surface, so spawning an animal costs no I/O and no extra pixels.
+class SpriteCache {
+private:
+  // Attention, NON-OWNING ptr to the screen, used for the pixel format
+  SDL_Surface* window_surface_ptr_;
+  std::map<std::string, std::shared_ptr<SDL_Surface>> sprites;
+public:
+  SpriteCache(SDL_Surface* window_surface_ptr);
+
+  // Loads the sprite at filePath scaled to w x h, or returns the cached one
+  std::shared_ptr<SDL_Surface> load(const std::string& filePath, int w, int h);
+  // Returns a sprite that was already loaded
+  std::shared_ptr<SDL_Surface> get(const std::string& filePath) const;
+};
+
+// Tags known at compile time, each one is a bit of a TagMask
+enum class Tag : uint8_t {
+  Sheep,
+  Wolf,
+  Prey,
+  Female,
+  Male,
+  Child,
+  Dead,
+  Player,
+  Dog,
+  Count
+};
+
+using TagMask = uint32_t;
+
+// Names of the known tags, in the order of the Tag enum
+constexpr std::array<std::string_view, static_cast<size_t>(Tag::Count)> tagNames = {
+  "sheep", "wolf", "prey", "female", "male", "child", "dead", "player", "dog"
+};
+static_assert(static_cast<size_t>(Tag::Count) <= sizeof(TagMask) * 8,
+              "TagMask is too small for the known tags");
+
+constexpr TagMask tag_bit(Tag tag) { return TagMask(1) << static_cast<unsigned>(tag); }
+constexpr bool has_tag(TagMask mask, Tag tag) { return (mask & tag_bit(tag)) != 0; }
+
+// Looks up a tag name in the registry, Tag::Count if it is not a known tag
+constexpr Tag find_tag(std::string_view name)
+{
+  for(size_t i = 0; i < tagNames.size(); ++i)
+  {
+    if(tagNames[i] == name) return static_cast<Tag>(i);
+  }
+  return Tag::Count;
+}
+
 class Interactable {
 protected:
-  std::set<std::string> tags;
+  TagMask tags = 0;
+  // Escape hatch for the rare tags that are not in the registry,
+  // stays empty (and does not allocate) for all the known tags
+  std::set<std::string, std::less<>> dynamicTags;
 public:
   virtual ~Interactable();
 
-  void addTag(const std::string& tag);
-  bool hasTag(const std::string& tag);
-  void removeTag(const std::string& tag);
+  void addTag(Tag tag) { tags |= tag_bit(tag); }
+  bool hasTag(Tag tag) const { return has_tag(tags, tag); }
+  void removeTag(Tag tag) { tags &= ~tag_bit(tag); }
+  TagMask getTags() const { return tags; }
+
+  // By name, known names are mapped to their bit
+  void addTag(std::string_view tag);
+  bool hasTag(std::string_view tag) const;
+  void removeTag(std::string_view tag);
   virtual void interact(std::shared_ptr<Interactable> other);
 };
 
 class RenderedObject : public Interactable {
 protected:
     SDL_Surface* window_surface_ptr_;
-    SDL_Surface* image_ptr_;
-    SDL_Rect animalRect;
+    // Shared with every object using the same sprite, see SpriteCache
+    std::shared_ptr<SDL_Surface> image_ptr_;
     int w, h, x, y;
+    // Position before the last simulation step, for the interpolation
+    int prevX, prevY;
 public:
-    RenderedObject(SDL_Surface* window, const std::string& textureFile);
+    RenderedObject(SDL_Surface* window, std::shared_ptr<SDL_Surface> sprite);
     virtual ~RenderedObject();
 
-    void draw();
+    // Draws at alpha between the previous (0) and the current position (1)
+    void draw(float alpha = 1.0f);
+    SDL_Rect getDrawRect(float alpha = 1.0f) const;
+    SDL_Surface* getSprite() const { return image_ptr_.get(); }
     void setPos(int x, int y);
+    void savePos() { prevX = x; prevY = y; }
     void setSize(int w, int h);
 
     int getWidth() { return w;}
@@ -92,18 +262,11 @@ class MovingObject : public RenderedObject {
 public:
     int xSpeed, ySpeed;
 public:
-    MovingObject(SDL_Surface* window, const std::string& textureFile);
+    MovingObject(SDL_Surface* window, std::shared_ptr<SDL_Surface> sprite);
     virtual ~MovingObject();
 
     virtual void move();
     void setSpeed(int x, int y);
-    void randomizeSpeed(int min, int max)
-    {
-      xSpeed = min + (std::rand() % (max - min));
-      ySpeed = min + (std::rand() % (max - min));
-
-      if(xSpeed == 0 && ySpeed == 0) randomizeSpeed(min, max);
-    }
     Vec2 getPos() {return {getX(), getY()};}
     int getDistTo(Vec2 pos) {
       int p = pos.x - getX(); //get the x cordinate difference between the current object and the given position
@@ -114,67 +277,113 @@ public:
 
 class animal : public MovingObject {
 public:
-  animal(SDL_Surface* window_surface_ptr,const std::string& file_path);
+  animal(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite);
   // todo: The constructor has to load the sdl_surface that corresponds to the
   // texture
   virtual ~animal(); // todo: Use the destructor to release memory and "clean up
                // behind you"
 };
 
-// Insert here:
-// class sheep, derived from animal
-class sheep : public animal {
-  // todo
-  // Ctor
-  int lastChild = 0;
-public:
-  sheep(SDL_Surface* window_surface_ptr,const std::string& file_path);
-  // Dtor
-  virtual ~sheep();
-
-  // implement functions that are purely virtual in base class
-  void move() override;
-  void interact(std::shared_ptr<Interactable> other) override;
-};
-
-// Insert here:
-// class wolf, derived from animal
-// Use only sheep at first. Once the application works
-// for sheep you can add the wolves
-class wolf : public animal {
-  std::vector<std::shared_ptr<MovingObject>> preyList;
-  std::shared_ptr<MovingObject> dog;
-  int lastFood = 0;
-public:
-  wolf(SDL_Surface* window_surface_ptr, const std::string& filePath);
-  // Dtor
-  virtual ~wolf();
-
-  // implement functions that are purely virtual in base class
-  void move() override;
-
-  void interact(std::shared_ptr<Interactable> other) override;
-
-  //TODO: Optimize with move
-    // Declares a function named "setPreyList" that takes in a parameter "list" which is a vector of shared pointers to MovingObjects.
-  void setPreyList(std::vector<std::shared_ptr<MovingObject>> list)
+// All the animals of one species stored as a structure of arrays.
+// Animal i is made of the i-th element of every array, so the systems of
+// ground walk through contiguous memory instead of chasing pointers.
+// Slots are recycled: a dead animal is replaced by the last one, and the
+// freed slot at the end is reused by the next birth. Once the capacity is
+// reserved, births and deaths never allocate.
+struct AnimalPool {
+  std::vector<int> x, y;
+  // Positions before the last step, for the interpolation
+  std::vector<int> prevX, prevY;
+  std::vector<int> xSpeed, ySpeed;
+  // Step of the last birth for sheep, of the last meal for wolves
+  std::vector<uint32_t> timer;
+  std::vector<TagMask> tags;
+  // Random stream of each animal, independent from the others
+  std::vector<SplitMix64> rng;
+
+  // Animals killed since the last remove_dead(), not a column
+  std::vector<uint32_t> dying;
+
+  // Calls f on every column, they all have one element per animal
+  template <class F>
+  void for_each_column(F f)
   {
-      // Clears the current preyList vector
-    preyList.clear();
-      // Assigns the passed in list to the preyList variable. This effectively replaces the current list with the new one.
-    preyList = list;
+    f(x); f(y);
+    f(prevX); f(prevY);
+    f(xSpeed); f(ySpeed);
+    f(timer);
+    f(tags);
+    f(rng);
   }
-    //This function is likely used to set the dog object in the game with a new object, or to change the dog object that is currently being used.
-  void setDog(std::shared_ptr<MovingObject> p)
+  template <class F>
+  void for_each_column(F f) const
   {
-      dog = p;
+    f(x); f(y);
+    f(prevX); f(prevY);
+    f(xSpeed); f(ySpeed);
+    f(timer);
+    f(tags);
+    f(rng);
   }
+
+  size_t size() const { return x.size(); }
+  size_t capacity() const { return x.capacity(); }
+  void reserve(size_t n);
+  // Appends n uninitialized animals at once, returns the index of the first
+  size_t grow(size_t n);
+  // Sets every column of animal i
+  // seed: start of the animal's random stream
+  void set(size_t i, Vec2 pos, Vec2 speed, uint32_t timer, TagMask tags, uint64_t seed);
+  // Appends an animal and returns its index
+  size_t add(Vec2 pos, Vec2 speed, uint32_t timer, TagMask tags, uint64_t seed);
+
+  void addTag(size_t i, Tag tag) { tags[i] |= tag_bit(tag); }
+  bool hasTag(size_t i, Tag tag) const { return has_tag(tags[i], tag); }
+  void removeTag(size_t i, Tag tag) { tags[i] &= ~tag_bit(tag); }
+  // Copies the positions to prevX/prevY
+  void save_positions();
+  // Flags animal i dead, it stays in the pool until remove_dead()
+  void kill(size_t i);
+  // Removes animal i in O(1), the last animal takes its index
+  void remove(size_t i);
+  // Removes the animals killed since the last call, O(1) each.
+  // removed(i, last) is called before animal i is removed, when the last
+  // animal, at index last, is about to take its place.
+  // Returns the number of removed animals
+  template <class F>
+  size_t remove_dead(F&& removed)
+  {
+      //From the highest index down, so the last animal moved into a hole
+      //is never one that still has to be removed
+    std::sort(dying.begin(), dying.end(), std::greater<uint32_t>());
+    for(uint32_t i : dying)
+    {
+      removed(i, size() - 1);
+      remove(i);
+    }
+
+    size_t count = dying.size();
+    dying.clear();
+    return count;
+  }
+  size_t remove_dead() { return remove_dead([](size_t, size_t) {}); }
 };
 
 class Player : public MovingObject {
+private:
+    // Minimal distance to the border of the screen
+    int boundary = frame_boundary;
 public:
-    Player(SDL_Surface* window_surface_ptr, const std::string& filePath);
+    Player(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite);
     void move() override;
+    void setBoundary(int b) { boundary = b; }
+};
+
+// Orbit and command state of the dog, saved in the snapshots
+struct DogState {
+  float angle, radius;
+  Vec2 targetPos;
+  uint8_t moveCommand, commandMode, moveBack;
 };
 
 class Dog : public animal {
@@ -184,10 +393,25 @@ class Dog : public animal {
     bool moveCommand = false;
     bool commandMode = false;
     bool moveBack = false;
+    int speed = dogSpeed;
     std::shared_ptr<MovingObject> roundCenter;
 public:
-    Dog(SDL_Surface* window_surface_ptr, const std::string& filePath);
+    Dog(SDL_Surface* window_surface_ptr, std::shared_ptr<SDL_Surface> sprite);
     void move() override;
+    void setDogSpeed(int s) { speed = s; }
+    DogState getState() const
+    {
+      return {angle, radius, targetPos, moveCommand, commandMode, moveBack};
+    }
+    void setState(const DogState& state)
+    {
+      angle = state.angle;
+      radius = state.radius;
+      targetPos = state.targetPos;
+      moveCommand = state.moveCommand;
+      commandMode = state.commandMode;
+      moveBack = state.moveBack;
+    }
     void setRoundCenter(std::shared_ptr<MovingObject> pos)
     {
       roundCenter = pos;
@@ -197,7 +421,7 @@ public:
       //Only one command at a time
       if(commandMode || moveCommand || moveBack) return;
 
-      std::cout << "command started" << std::endl;
+      LOG(Info, "command started");
       commandMode = true;
 
     }
@@ -208,43 +432,160 @@ public:
       if(!commandMode) return; // If the dog is not currently in command mode, return and do nothing
       if(moveCommand) return; // If the dog is already moving towards a command, return and do nothing
 
-      std::cout << "Command ended" << std::endl;
+      LOG(Info, "Command ended");
       commandMode = false;
       targetPos = location; // Store the target position where the dog should move to
       moveCommand = true; // Indicates that the dog should now move to the target position
     }
 };
 
+// A sprite over the last step of the simulation
+struct SpriteMotion {
+  SDL_Surface* sprite;
+  // Where it was drawn before the step, with its size
+  SDL_Rect from;
+  // Where it is after the step
+  int toX, toY;
+};
+
+// What the ground looks like after a step, handed to the thread drawing it
+struct FrameSnapshot {
+  std::vector<SpriteMotion> sprites;
+  uint32_t tick = 0;
+  int score = 0;
+  // Performance counter when it was published, and wall clock seconds of
+  // a step, to draw it between the two steps
+  Uint64 published = 0;
+  double stepSeconds = frame_time;
+};
+
 // The "ground" on which all the animals live (like the std::vector
 // in the zoo example).
 class ground {
 private:
   // Attention, NON-OWNING ptr, again to the screen
   SDL_Surface* window_surface_ptr_;
+  // Tuning values, the default ones take the constant folded path
+  SimParams params;
+  bool defaultParams;
+  // Advanced once per update, drives the breed and starve timers
+  SimClock clock;
+  // Rate of each system and the time spent in it
+  SystemScheduler systems;
+  SystemScheduler::Id timerSystem, moveSystem, deathSystem, breedSystem;
+  // Random generator of the spawns, every animal gets its own stream from it
+  Rng rng;
+  // Sprites shared by all the animals, loaded once when the ground is created
+  SpriteCache sprites;
+  // Redraws only the parts of the window that changed
+  DirtyRenderer renderer;
+  // Sprites of the frame being drawn, kept to avoid allocations
+  std::vector<SpriteDraw> frame;
   // Some attribute to store all the wolves and sheep
   // here
 
-  std::set<std::shared_ptr<MovingObject>> allAnimals;
-  std::set<std::shared_ptr<wolf>> wolves;
-  std::set<std::shared_ptr<sheep>> sheeps;
+  AnimalPool sheeps;
+  AnimalPool wolves;
+  // Sheep positions bucketed for the hunting and breeding queries
+  SpatialGrid sheepGrid;
+  // Step at which each wolf starves, keyed by its slot in the pool
+  TimerWheel starveTimers;
+  // End of the breeding cooldown of each female sheep, keyed by her slot
+  TimerWheel breedTimers;
+  // Female sheep past their cooldown, waiting for a male
+  SlotSet readySheep;
+  // The ready sheep in the order of the pool, for the breeding system
+  std::vector<uint32_t> breeders;
+  // Results of the parallel systems, merged in order afterwards
+  std::vector<int> kills;
+  std::vector<uint8_t> mated;
+  // Positions of the lambs born during this step
+  std::vector<Vec2> births;
+  // Threads running the systems, NON-OWNING, NULL to run on the caller
+  JobSystem* jobs = NULL;
+  // Times the systems, NON-OWNING, NULL when not profiling
+  FrameProfiler* profiler = NULL;
+
+  // Runs f(begin, end) over the animals [0, count[, split over the job
+  // system when there is one. f must only write the slots of its range.
+  template <class F>
+  void parallel_for(size_t count, F&& f)
+  {
+    if(jobs) jobs->parallel_for(count, parallel_grain, f);
+    else f(size_t(0), count);
+  }
   std::shared_ptr<Player> player;
   std::shared_ptr<Dog> dog;
 
   bool commandingUnit = false;
+
+  // Fills slot i of the pool of species id with a new animal
+  void init_animal(int id, size_t i, Vec2 pos, bool random);
+  // Schedules the starvation of wolf i from its last meal
+  void arm_wolf(size_t i);
+  // Schedules the end of the breeding cooldown of sheep i if she is a
+  // female, or makes her ready at once when it is already over
+  void arm_sheep(size_t i);
+  // Schedules every animal again from the timer columns
+  void arm_timers();
+  // One step of update() with the parameters of P
+  template <class P>
+  void step(const P& p);
 public:
-  ground(SDL_Surface* window_surface_ptr); // todo: Ctor
+  ground(SDL_Surface* window_surface_ptr, uint64_t seed, const SimParams& params = SimParams()); // todo: Ctor
   ~ground(); // todo: Dtor, again for clean up (if necessary)
   void add_animal(int id, Vec2 pos = {0, 0}, bool random = false); // todo: Add an animal
-  void update(); // todo: "refresh the screen": Move animals and draw them
+  // Adds an animal of species id at each position, as many as maxAnimals allows,
+  // the pool grows once for all of them
+  void add_animals(int id, const std::vector<Vec2>& positions);
+  void update(); // Move the animals, one step of the simulation
+  // "refresh the screen": draw the animals at alpha between the last two
+  // steps, nothing when headless
+  void draw(float alpha = 1.0f);
+  // Fills out with the sprites of the last step, reuses its capacity
+  void snapshot(FrameSnapshot& out) const;
+  // Draws a snapshot at alpha between its two steps. It only uses the
+  // renderer, so it can run while another thread updates the ground.
+  void draw(const FrameSnapshot& snap, float alpha);
   // Possibly other methods, depends on your implementation
   void add_player();
   void add_shepherd_dog();
+  // Adds the player, the dog and n_sheep sheep and n_wolf wolves at random places
+  void populate(unsigned n_sheep, unsigned n_wolf);
   void setPlayerInput(int ix, int iy);
   void setMouseInput(int x, int y);
 
+  // Systems, each one walks the pools it needs
+  // Handles the deadlines reached at step now, only the animals concerned
+  void fire_timers(uint32_t now);
+  template <class P> void move_sheep(const P& p);
+  template <class P> void hunt(uint32_t now, const P& p);
+  void draw_animals(float alpha);
   void remove_dead_animals();
-  void add_new_animals();
-
+  template <class P> void add_new_animals(uint32_t now, const P& p);
+
+  // Sprite of the cache, nullptr when headless
+  std::shared_ptr<SDL_Surface> sprite_for(const std::string& filePath) const;
+
+  size_t animal_count() const { return sheeps.size() + wolves.size() + (dog ? 1 : 0); }
+  const SimParams& getParams() const { return params; }
+  size_t sheep_count() const { return sheeps.size(); }
+  size_t wolf_count() const { return wolves.size(); }
+  // Cost of each system since the start
+  void report_systems(std::ostream& out) const { systems.report(out); }
+  // Parts of the window changed by the last draw(), NULL for all of it
+  const std::vector<SDL_Rect>* dirty_rects() const { return renderer.dirty_rects(); }
+  // The next draw() repaints the whole window
+  void redraw_all() { renderer.invalidate(); }
+
+  // Writes every entity, the random generator and the clock to path
+  void save(const std::string& path) const;
+  // Replaces the whole world by the one saved in path
+  void load(const std::string& path);
+
+  void setJobSystem(JobSystem* jobSystem) { jobs = jobSystem; }
+  void setProfiler(FrameProfiler* frameProfiler) { profiler = frameProfiler; }
+  const SimClock& getClock() const { return clock; }
   int getScore() const { return sheeps.size();};
 };
 
@@ -258,11 +599,53 @@ private:
 
 
   unsigned int frameRate = 60;
+  // No window, the ground is simulated as fast as possible
+  bool headless_;
+  // Simulation steps per frame_time of wall clock
+  unsigned fastForward_ = 1;
 
   // Other attributes here, for example an instance of ground
   std::unique_ptr<ground> gameGround;
+  // Threads of the simulation systems, none when running on one thread
+  std::unique_ptr<JobSystem> jobs;
+  // Phase timings, none when not profiling
+  std::unique_ptr<FrameProfiler> profiler;
+  // Draw the profiler bars over the ground
+  bool overlay_ = false;
+  // Rects presented in a frame, kept to avoid allocations
+  std::vector<SDL_Rect> presentRects;
+
+  // Inputs of the run written to a file, none when not recording
+  std::unique_ptr<InputRecorder> recorder;
+  // Inputs given to the ground instead of the live ones, none when not replaying
+  std::unique_ptr<InputReplay> replay;
+
+  // Simulate on a thread of its own, the main thread only draws
+  bool renderThread_ = false;
+  // Last step published by the simulation thread
+  TripleBuffer<FrameSnapshot> frames;
+  // Inputs waiting for the simulation thread, the tick is set when it takes them
+  bool queueInputs = false;
+  std::mutex inputMutex;
+  std::vector<InputEvent> pendingInputs;
+  std::vector<InputEvent> takenInputs;
+
+  // Presents the changed parts of the window and the overlay
+  void present();
+  // Give an input to the ground, recording it first
+  void player_input(int ix, int iy);
+  void mouse_input(int x, int y);
+  void give_input(InputEvent e);
+  void apply_input(InputEvent e);
+  // Simulation thread: applies the queued inputs, never waits for them
+  void apply_queued_inputs();
+  // Handles the pending SDL events, returns false to quit
+  bool poll_events();
+  // loop() with the simulation on its own thread
+  int loop_threaded(unsigned period);
 public:
-  application(unsigned n_sheep, unsigned n_wolf); // Ctor
+  application(unsigned n_sheep, unsigned n_wolf, uint64_t seed, bool headless = false,
+              const SimParams& params = SimParams()); // Ctor
   ~application();                                 // dtor
 
   int loop(unsigned period); // main loop of the application.
@@ -271,4 +654,26 @@ public:
                              // See SDL_GetTicks() and SDL_Delay() to enforce a
                              // duration the application should terminate after
                              // 'period' seconds
+  int loop_headless(unsigned period); // simulation only, not paced
+
+  // Runs 'speed' simulation steps per frame_time, 1 is real time
+  void setFastForward(unsigned speed) { fastForward_ = speed > 0 ? speed : 1; }
+  // Runs the simulation systems on 'threads' threads, 0 for one per core
+  void setThreads(unsigned threads);
+  // Simulates on a worker thread publishing snapshots, the main thread
+  // handles the events and draws the latest one at its own rate
+  void setRenderThread(bool on) { renderThread_ = on; }
+  // Writes every input with the tick at which the ground gets it
+  // header: seed and animals of this run, to start the same world again
+  void setRecording(const std::string& path, const RecordingHeader& header);
+  // Runs headless with the inputs of a recording until its end tick,
+  // the application must be created with the seed and animals of its header
+  void setReplay(std::unique_ptr<InputReplay> inputs);
+  // Snapshot of the whole world, see ground::save() and ground::load()
+  void save(const std::string& path) const { gameGround->save(path); }
+  void load(const std::string& path) { gameGround->load(path); }
+  // Times every phase of the frames and prints a report at the end
+  // csvPath: every frame is also written there, nothing if empty
+  // overlay: the p95 of the phases is drawn in the window
+  void setProfiling(const std::string& csvPath, bool overlay);
 };
@@ -0,0 +1,98 @@
+// Random.h: Seeded random number generators of the simulation.
+// Every generator is a UniformRandomBitGenerator, so any of them can be
+// used with random_range() or with the <random> distributions.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// SplitMix64, 8 bytes of state.
+// Used for the per-animal streams and to seed the other generators.
+struct SplitMix64 {
+  using result_type = uint64_t;
+  uint64_t state;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()()
+  {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+};
+
+// xoshiro256**, main stream of a ground.
+// jump() skips 2^128 values, giving non-overlapping streams for threads.
+class Xoshiro256 {
+private:
+  uint64_t s[4];
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+public:
+  using result_type = uint64_t;
+
+  explicit Xoshiro256(uint64_t seed)
+  {
+    SplitMix64 init{seed};
+    for(auto& v : s) v = init();
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  // Whole state, to save the generator and restore it later
+  std::array<uint64_t, 4> state() const { return {s[0], s[1], s[2], s[3]}; }
+  void setState(const std::array<uint64_t, 4>& state)
+  {
+    for(int i = 0; i < 4; ++i) s[i] = state[i];
+  }
+
+  result_type operator()()
+  {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  void jump()
+  {
+    static constexpr uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                         0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+    uint64_t t[4] = {0, 0, 0, 0};
+    for(uint64_t j : JUMP)
+    {
+      for(int b = 0; b < 64; ++b)
+      {
+        if(j & (uint64_t(1) << b))
+        {
+          for(int i = 0; i < 4; ++i) t[i] ^= s[i];
+        }
+        (*this)();
+      }
+    }
+    for(int i = 0; i < 4; ++i) s[i] = t[i];
+  }
+};
+
+// Generator used by the ground, change it here to try another one
+using Rng = Xoshiro256;
+
+// Uniform integer in [min, max[, using the high bits of the generator
+template <class Gen>
+int random_range(Gen& gen, int min, int max)
+{
+  uint64_t range = (uint64_t)((int64_t)max - min);
+  uint64_t bits = (uint64_t)gen() >> 32;
+  return min + (int)((bits * range) >> 32);
+}
@@ -0,0 +1,18 @@
+// Simd.h: Target attributes of the kernels picked at runtime from the CPU.
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// The SIMD kernels are compiled for their instruction set whatever the
+// flags of the build, they only run when the CPU has it
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
@@ -0,0 +1,104 @@
+// Snapshot.cpp: Compact binary files holding the state of a world.
+//
+
+#include "Snapshot.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+{
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file_ == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("MappedFile: cannot open " + path);
+
+  LARGE_INTEGER size;
+  GetFileSizeEx(file_, &size);
+  size_ = (size_t)size.QuadPart;
+    //An empty file cannot be mapped, it is read as 0 bytes
+  if(size_ == 0) return;
+
+  mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(mapping_ != NULL)
+    data_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+  if(data_ == NULL)
+  {
+    if(mapping_ != NULL) CloseHandle(mapping_);
+    CloseHandle(file_);
+    throw std::runtime_error("MappedFile: cannot map " + path);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if(data_ != NULL) UnmapViewOfFile(data_);
+  if(mapping_ != NULL) CloseHandle(mapping_);
+  CloseHandle(file_);
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw std::runtime_error("MappedFile: cannot open " + path);
+
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+  {
+    close(fd);
+    throw std::runtime_error("MappedFile: cannot stat " + path);
+  }
+  size_ = (size_t)st.st_size;
+  if(size_ > 0)
+  {
+    void* p = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    data_ = (const uint8_t*)p;
+  }
+    //The mapping stays valid once the descriptor is closed
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if(data_ != NULL) munmap(const_cast<uint8_t*>(data_), size_);
+}
+#endif
+
+uint64_t snapshot_file_hash(const std::string& path)
+{
+  MappedFile file(path);
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(size_t i = 0; i < file.size(); ++i)
+  {
+    hash = (hash ^ file.data()[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void SnapshotWriter::write_file(const std::string& path) const
+{
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if(f == NULL)
+    throw std::runtime_error("SnapshotWriter: cannot open " + path);
+
+    //The whole snapshot in a single write
+  size_t written = std::fwrite(buffer.data(), 1, buffer.size(), f);
+  bool closed = std::fclose(f) == 0;
+  if(written != buffer.size() || !closed)
+    throw std::runtime_error("SnapshotWriter: cannot write " + path);
+}
@@ -0,0 +1,118 @@
+// Snapshot.h: Compact binary files holding the state of a world.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// First bytes of every snapshot, and the version of the layout after them
+constexpr std::array<char, 4> snapshot_magic = {'S', 'H', 'E', 'P'};
+constexpr uint32_t snapshot_version = 1;
+// Written as is, a snapshot is only read back on a machine of the same endianness
+constexpr uint32_t snapshot_endian = 0x01020304;
+
+// Read-only view of a whole file mapped in memory
+class MappedFile {
+private:
+  const uint8_t* data_ = NULL;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* file_ = NULL;
+  void* mapping_ = NULL;
+#endif
+public:
+  // Throws std::runtime_error if path cannot be mapped
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+};
+
+// FNV-1a hash of the bytes of the file at path, to tell two snapshots apart.
+// Throws std::runtime_error if path cannot be mapped
+uint64_t snapshot_file_hash(const std::string& path);
+
+// Builds a snapshot in memory, the file is written in one go.
+// Values are stored with their native layout, columns start on 8 bytes.
+class SnapshotWriter {
+private:
+  std::vector<uint8_t> buffer;
+public:
+  void reserve(size_t bytes) { buffer.reserve(bytes); }
+
+  template <class T>
+  void put(const T& v)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot values are copied as bytes");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    buffer.insert(buffer.end(), p, p + sizeof(T));
+  }
+
+  // The whole column as one block of bytes
+  template <class T>
+  void column(const std::vector<T>& values)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot columns are copied as bytes");
+    align();
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(values.data());
+    buffer.insert(buffer.end(), p, p + values.size() * sizeof(T));
+  }
+
+  void align() { buffer.resize((buffer.size() + 7) & ~size_t(7), 0); }
+
+  // Throws std::runtime_error if the file cannot be written
+  void write_file(const std::string& path) const;
+};
+
+// Reads a snapshot straight from its mapping, columns are copied as
+// blocks without looking at the animals one by one
+class SnapshotReader {
+private:
+  MappedFile file;
+  size_t pos = 0;
+
+  void need(size_t bytes) const
+  {
+    if(bytes > file.size() - pos)
+      throw std::runtime_error("SnapshotReader: truncated snapshot");
+  }
+public:
+  explicit SnapshotReader(const std::string& path) : file(path) {}
+
+  template <class T>
+  T get()
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot values are copied as bytes");
+    need(sizeof(T));
+    T v;
+    std::memcpy(&v, file.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+  }
+
+  // Replaces values with the next n elements
+  template <class T>
+  void column(std::vector<T>& values, size_t n)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot columns are copied as bytes");
+    align();
+    if(n > (file.size() - pos) / sizeof(T))
+      throw std::runtime_error("SnapshotReader: truncated snapshot");
+    const T* first = reinterpret_cast<const T*>(file.data() + pos);
+    values.assign(first, first + n);
+    pos += n * sizeof(T);
+  }
+
+  void align() { pos = std::min((pos + 7) & ~size_t(7), file.size()); }
+};
@@ -0,0 +1,146 @@
+// SpatialGrid.cpp: Uniform grid used to find animals close to a position.
+//
+
+#include "SpatialGrid.h"
+#include "NearestKernel.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+// Division rounding towards minus infinity
+int floor_div(int a, int b)
+{
+  int q = a / b;
+  if((a % b != 0) && ((a < 0) != (b < 0))) --q;
+  return q;
+}
+} // namespace
+
+SpatialGrid::SpatialGrid(int width, int height, int cellSize)
+  : cellSize(cellSize)
+{
+  cols = std::max(1, (width + cellSize - 1) / cellSize);
+  rows = std::max(1, (height + cellSize - 1) / cellSize);
+  cellStart.assign(cols * rows + 1, 0);
+}
+
+int SpatialGrid::cell_x(int x) const
+{
+  return std::clamp(floor_div(x, cellSize), 0, cols - 1);
+}
+
+int SpatialGrid::cell_y(int y) const
+{
+  return std::clamp(floor_div(y, cellSize), 0, rows - 1);
+}
+
+void SpatialGrid::build(const std::vector<int>& x, const std::vector<int>& y)
+{
+  size_t n = x.size();
+  cellOf.resize(n);
+  index.resize(n);
+  px.resize(n);
+  py.resize(n);
+
+    //Count the points of every cell
+  std::fill(cellStart.begin(), cellStart.end(), 0);
+  for(size_t i = 0; i < n; ++i)
+  {
+    cellOf[i] = cell_y(y[i]) * cols + cell_x(x[i]);
+    ++cellStart[cellOf[i] + 1];
+  }
+    //Prefix sum, cellStart[c] is now the first slot of cell c
+  for(size_t c = 1; c < cellStart.size(); ++c)
+  {
+    cellStart[c] += cellStart[c - 1];
+  }
+    //Scatter the points, cellStart[c] is used as the insert position and
+    //ends up at the start of the next cell
+  for(size_t i = 0; i < n; ++i)
+  {
+    uint32_t k = cellStart[cellOf[i]]++;
+    index[k] = i;
+    px[k] = x[i];
+    py[k] = y[i];
+  }
+    //Shift back to get the starts
+  for(size_t c = cellStart.size() - 1; c > 0; --c)
+  {
+    cellStart[c] = cellStart[c - 1];
+  }
+  cellStart[0] = 0;
+}
+
+GridHit SpatialGrid::nearest(int x, int y) const
+{
+  GridHit best{-1, INT_MAX};
+  if(index.empty()) return best;
+
+    //Cell of the query, it can be outside of the grid
+  int qx = floor_div(x, cellSize);
+  int qy = floor_div(y, cellSize);
+  int rmax = std::max(std::max(std::abs(qx), std::abs(qx - (cols - 1))),
+                      std::max(std::abs(qy), std::abs(qy - (rows - 1))));
+
+    //Calls f(first, end) on the points of the cells of ring r, the cells
+    //of a row are next to each other so a row is a single range
+  auto for_each_span = [&](int r, auto f) {
+    auto row = [&](int cy) {
+      if(cy < 0 || cy >= rows) return;
+      int x0 = std::max(qx - r, 0), x1 = std::min(qx + r, cols - 1);
+      if(x0 > x1) return;
+      f(cellStart[cy * cols + x0], cellStart[cy * cols + x1 + 1]);
+    };
+    auto cell = [&](int cx, int cy) {
+      if(cx < 0 || cx >= cols || cy < 0 || cy >= rows) return;
+      f(cellStart[cy * cols + cx], cellStart[cy * cols + cx + 1]);
+    };
+    row(qy - r);
+    if(r > 0) row(qy + r);
+    for(int cy = qy - r + 1; cy <= qy + r - 1; ++cy)
+    {
+      cell(qx - r, cy);
+      cell(qx + r, cy);
+    }
+  };
+
+    //Smallest squared distance, walking the rings of cells around the query
+  bool found = false;
+  int bestDist2 = INT_MAX;
+  int last = rmax;
+  for(int r = 0; r <= rmax; ++r)
+  {
+      //Every point of ring r is further than (r - 1) cells away
+    if(found && (r - 1) * cellSize > best.dist)
+    {
+      last = r - 1;
+      break;
+    }
+
+    for_each_span(r, [&](uint32_t first, uint32_t end) {
+      NearestHit hit = nearest_point(px.data() + first, py.data() + first, end - first, x, y);
+      if(hit.pos < 0) return;
+      found = true;
+      bestDist2 = std::min(bestDist2, hit.dist2);
+    });
+    if(found) best.dist = std::sqrt(bestDist2);
+  }
+  if(!found) return best;
+
+    //The distance is truncated, every point at the same truncated distance
+    //ties and the lowest index wins like in a linear scan
+  int limit2 = (int)std::min<int64_t>((int64_t)(best.dist + 1) * (best.dist + 1) - 1, INT_MAX);
+  int lowest = INT32_MAX;
+  for(int r = 0; r <= last; ++r)
+  {
+    for_each_span(r, [&](uint32_t first, uint32_t end) {
+      lowest = std::min(lowest, lowest_id_within(px.data() + first, py.data() + first,
+                                                 index.data() + first, end - first, x, y, limit2));
+    });
+  }
+  best.index = lowest;
+  return best;
+}
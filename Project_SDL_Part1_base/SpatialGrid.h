@@ -0,0 +1,68 @@
+// SpatialGrid.h: Uniform grid used to find animals close to a position.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Result of a nearest neighbour search
+struct GridHit {
+  int index; // index of the point in the arrays given to build(), -1 if none
+  int dist;  // euclidean distance truncated to an int
+};
+
+// Uniform grid over the ground, rebuilt from the positions of a pool.
+// Points are bucketed by cell with a counting sort, their coordinates are
+// copied in cell order so a query only reads a few contiguous ranges.
+// Points outside of the grid are clamped in the border cells.
+class SpatialGrid {
+private:
+  int cellSize;
+  int cols, rows;
+  // Points of cell c are in [cellStart[c], cellStart[c + 1])
+  std::vector<uint32_t> cellStart;
+  // Index and coordinates of the points, sorted by cell
+  std::vector<uint32_t> index;
+  std::vector<int> px, py;
+  // Cell of each point, kept between builds to avoid allocations
+  std::vector<uint32_t> cellOf;
+
+  int cell_x(int x) const;
+  int cell_y(int y) const;
+public:
+  // width x height area split in cells of cellSize pixels
+  SpatialGrid(int width, int height, int cellSize);
+
+  // Buckets the points (x[i], y[i])
+  void build(const std::vector<int>& x, const std::vector<int>& y);
+
+  // Closest point to (x, y), same result as a linear scan keeping the
+  // first point with the smallest truncated distance.
+  // The cells are scanned with the SIMD kernels on squared distances,
+  // only the best one is square rooted.
+  GridHit nearest(int x, int y) const;
+
+  // Calls pred(i) for the points closer than radius to (x, y) until it
+  // returns true, returns whether it did
+  template <class Pred>
+  bool find_in_radius(int x, int y, int radius, Pred pred) const
+  {
+    int x0 = cell_x(x - radius), x1 = cell_x(x + radius);
+    int y0 = cell_y(y - radius), y1 = cell_y(y + radius);
+    int r2 = radius * radius;
+    for(int cy = y0; cy <= y1; ++cy)
+    {
+      for(int cx = x0; cx <= x1; ++cx)
+      {
+        int c = cy * cols + cx;
+        for(uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k)
+        {
+          int dx = px[k] - x;
+          int dy = py[k] - y;
+          if(dx * dx + dy * dy < r2 && pred(index[k])) return true;
+        }
+      }
+    }
+    return false;
+  }
+};
@@ -0,0 +1,263 @@
+// SpriteBlitter.cpp: Copies pre-scaled 32 bit sprites onto the window.
+//
+
+#include "SpriteBlitter.h"
+#include "Simd.h"
+
+#include <cstring>
+
+namespace {
+// Row kernels, n pixels from src over dst
+using ColorKeyRow = void (*)(const Uint32* src, Uint32* dst, int n, Uint32 key, Uint32 rgbMask);
+using AlphaRow = void (*)(const Uint32* src, Uint32* dst, int n, int aShift);
+
+// Channel s at alpha a over d, the same rounding in every kernel
+inline Uint32 blend_channel(Uint32 s, Uint32 d, Uint32 a)
+{
+  Uint32 x = s * a + d * (255 - a) + 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+void color_key_scalar(const Uint32* src, Uint32* dst, int n, Uint32 key, Uint32 rgbMask)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    if((src[i] & rgbMask) != key) dst[i] = src[i];
+  }
+}
+
+void alpha_scalar(const Uint32* src, Uint32* dst, int n, int aShift)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    Uint32 s = src[i], d = dst[i];
+    Uint32 a = (s >> aShift) & 0xFF;
+    Uint32 r = 0;
+    for(int c = 0; c < 32; c += 8)
+    {
+      r |= blend_channel((s >> c) & 0xFF, (d >> c) & 0xFF, a) << c;
+    }
+    dst[i] = r;
+  }
+}
+
+#ifdef SIMD_X86
+TARGET_SSE2 void color_key_sse2(const Uint32* src, Uint32* dst, int n, Uint32 key, Uint32 rgbMask)
+{
+  const __m128i keyv = _mm_set1_epi32((int)key);
+  const __m128i maskv = _mm_set1_epi32((int)rgbMask);
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+  {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      //All ones where the pixel is the key, the target is kept there
+    __m128i keyed = _mm_cmpeq_epi32(_mm_and_si128(s, maskv), keyv);
+    __m128i r = _mm_or_si128(_mm_and_si128(keyed, d), _mm_andnot_si128(keyed, s));
+    _mm_storeu_si128((__m128i*)(dst + i), r);
+  }
+  color_key_scalar(src + i, dst + i, n - i, key, rgbMask);
+}
+
+// Blends 4 pixels with 16 bits per channel, alpha in the highest byte
+TARGET_SSE2 inline __m128i blend4_sse2(__m128i s, __m128i d)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i v255 = _mm_set1_epi16(255);
+  const __m128i v128 = _mm_set1_epi16(128);
+
+  __m128i halves[2];
+  for(int h = 0; h < 2; ++h)
+  {
+    __m128i s16 = h == 0 ? _mm_unpacklo_epi8(s, zero) : _mm_unpackhi_epi8(s, zero);
+    __m128i d16 = h == 0 ? _mm_unpacklo_epi8(d, zero) : _mm_unpackhi_epi8(d, zero);
+      //Alpha of each pixel on its 4 channels
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(s16, a),
+                              _mm_mullo_epi16(d16, _mm_sub_epi16(v255, a)));
+    x = _mm_add_epi16(x, v128);
+    halves[h] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+  }
+  return _mm_packus_epi16(halves[0], halves[1]);
+}
+
+TARGET_SSE2 void alpha_sse2(const Uint32* src, Uint32* dst, int n, int aShift)
+{
+  int i = 0;
+    //The shuffles need the alpha in the highest byte
+  if(aShift == 24)
+  {
+    for(; i + 4 <= n; i += 4)
+    {
+      __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      _mm_storeu_si128((__m128i*)(dst + i), blend4_sse2(s, d));
+    }
+  }
+  alpha_scalar(src + i, dst + i, n - i, aShift);
+}
+
+TARGET_AVX2 void color_key_avx2(const Uint32* src, Uint32* dst, int n, Uint32 key, Uint32 rgbMask)
+{
+  const __m256i keyv = _mm256_set1_epi32((int)key);
+  const __m256i maskv = _mm256_set1_epi32((int)rgbMask);
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+    __m256i keyed = _mm256_cmpeq_epi32(_mm256_and_si256(s, maskv), keyv);
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_blendv_epi8(s, d, keyed));
+  }
+  color_key_scalar(src + i, dst + i, n - i, key, rgbMask);
+}
+
+TARGET_AVX2 void alpha_avx2(const Uint32* src, Uint32* dst, int n, int aShift)
+{
+  int i = 0;
+  if(aShift == 24)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i v255 = _mm256_set1_epi16(255);
+    const __m256i v128 = _mm256_set1_epi16(128);
+    for(; i + 8 <= n; i += 8)
+    {
+      __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+      __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+
+        //Unpack and pack stay in their 128 bit lane, the pixel order is kept
+      __m256i halves[2];
+      for(int h = 0; h < 2; ++h)
+      {
+        __m256i s16 = h == 0 ? _mm256_unpacklo_epi8(s, zero) : _mm256_unpackhi_epi8(s, zero);
+        __m256i d16 = h == 0 ? _mm256_unpacklo_epi8(d, zero) : _mm256_unpackhi_epi8(d, zero);
+        __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xFF), 0xFF);
+        __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(s16, a),
+                                     _mm256_mullo_epi16(d16, _mm256_sub_epi16(v255, a)));
+        x = _mm256_add_epi16(x, v128);
+        halves[h] = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+      }
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+  }
+  alpha_sse2(src + i, dst + i, n - i, aShift);
+}
+#endif
+
+// Kernels of the best instruction set of the CPU
+struct Kernels {
+  const char* name;
+  ColorKeyRow colorKey;
+  AlphaRow alpha;
+};
+
+Kernels pick_kernels()
+{
+#ifdef SIMD_X86
+  if(SDL_HasAVX2()) return {"avx2", color_key_avx2, alpha_avx2};
+  if(SDL_HasSSE2()) return {"sse2", color_key_sse2, alpha_sse2};
+#endif
+  return {"scalar", color_key_scalar, alpha_scalar};
+}
+
+const Kernels& kernels()
+{
+  static const Kernels picked = pick_kernels();
+  return picked;
+}
+} // namespace
+
+BlitMode blit_mode(SDL_Surface* sprite)
+{
+  Uint32 key;
+  if(SDL_GetColorKey(sprite, &key) == 0) return BlitMode::ColorKey;
+
+  SDL_BlendMode blend;
+  SDL_GetSurfaceBlendMode(sprite, &blend);
+  if(blend == SDL_BLENDMODE_BLEND && sprite->format->Amask != 0) return BlitMode::Alpha;
+  return BlitMode::Opaque;
+}
+
+bool can_fast_blit(SDL_Surface* sprite, SDL_Surface* target)
+{
+  const SDL_PixelFormat* s = sprite->format;
+  const SDL_PixelFormat* t = target->format;
+  if(s->BytesPerPixel != 4 || t->BytesPerPixel != 4) return false;
+  if(s->Rmask != t->Rmask || s->Gmask != t->Gmask || s->Bmask != t->Bmask) return false;
+  if((sprite->flags & SDL_RLEACCEL) != 0) return false;
+
+    //Color and alpha modulation are left to SDL
+  Uint8 r, g, b, a;
+  SDL_GetSurfaceColorMod(sprite, &r, &g, &b);
+  SDL_GetSurfaceAlphaMod(sprite, &a);
+  if(r != 255 || g != 255 || b != 255 || a != 255) return false;
+
+  SDL_BlendMode blend;
+  SDL_GetSurfaceBlendMode(sprite, &blend);
+  if(blend != SDL_BLENDMODE_NONE && blend != SDL_BLENDMODE_BLEND) return false;
+    //A color key and an alpha blend together are left to SDL too
+  Uint32 key;
+  if(SDL_GetColorKey(sprite, &key) == 0 && blend == SDL_BLENDMODE_BLEND && s->Amask != 0) return false;
+  return true;
+}
+
+void blit_sprite(SDL_Surface* sprite, SDL_Surface* target, const SDL_Rect& rect)
+{
+  if(rect.w != sprite->w || rect.h != sprite->h || !can_fast_blit(sprite, target))
+  {
+    SDL_Rect dst = rect;
+    SDL_BlitScaled(sprite, NULL, target, &dst);
+    return;
+  }
+
+  SDL_Rect clipped;
+  if(!SDL_IntersectRect(&rect, &target->clip_rect, &clipped)) return;
+
+  if(SDL_MUSTLOCK(target) && SDL_LockSurface(target) != 0) return;
+
+  const Uint8* src = (const Uint8*)sprite->pixels
+                   + (clipped.y - rect.y) * sprite->pitch + (clipped.x - rect.x) * 4;
+  Uint8* dst = (Uint8*)target->pixels + clipped.y * target->pitch + clipped.x * 4;
+
+  switch(blit_mode(sprite))
+  {
+    case BlitMode::Opaque:
+      for(int row = 0; row < clipped.h; ++row)
+      {
+        std::memcpy(dst + row * target->pitch, src + row * sprite->pitch, clipped.w * 4);
+      }
+      break;
+    case BlitMode::ColorKey:
+    {
+      Uint32 rgbMask = ~sprite->format->Amask;
+      Uint32 key;
+      SDL_GetColorKey(sprite, &key);
+      key &= rgbMask;
+      ColorKeyRow row_kernel = kernels().colorKey;
+      for(int row = 0; row < clipped.h; ++row)
+      {
+        row_kernel((const Uint32*)(src + row * sprite->pitch),
+                   (Uint32*)(dst + row * target->pitch), clipped.w, key, rgbMask);
+      }
+      break;
+    }
+    case BlitMode::Alpha:
+    {
+      int aShift = sprite->format->Ashift;
+      AlphaRow row_kernel = kernels().alpha;
+      for(int row = 0; row < clipped.h; ++row)
+      {
+        row_kernel((const Uint32*)(src + row * sprite->pitch),
+                   (Uint32*)(dst + row * target->pitch), clipped.w, aShift);
+      }
+      break;
+    }
+  }
+
+  if(SDL_MUSTLOCK(target)) SDL_UnlockSurface(target);
+}
+
+const char* blit_kernel_name()
+{
+  return kernels().name;
+}
@@ -0,0 +1,28 @@
+// SpriteBlitter.h: Copies pre-scaled 32 bit sprites onto the window.
+
+#pragma once
+
+#include <SDL.h>
+
+// How the pixels of a sprite are combined with the target
+enum class BlitMode {
+  Opaque,   // every pixel is copied
+  ColorKey, // pixels equal to the color key are skipped
+  Alpha     // pixels are blended with their alpha
+};
+
+// Mode SDL would use to blit sprite, read from its color key and blend mode
+BlitMode blit_mode(SDL_Surface* sprite);
+
+// Whether blit_sprite() can draw sprite on target without SDL: both are
+// 32 bit with the same color channels, they are not RLE encoded
+bool can_fast_blit(SDL_Surface* sprite, SDL_Surface* target);
+
+// Draws sprite at rect on target, clipped to the clip rect of target.
+// A sprite already at the size of rect is copied row by row by an SSE2 or
+// AVX2 kernel, picked once from the CPU features. Any other sprite goes
+// through SDL_BlitScaled as before.
+void blit_sprite(SDL_Surface* sprite, SDL_Surface* target, const SDL_Rect& rect);
+
+// Name of the kernels picked for this CPU: "avx2", "sse2" or "scalar"
+const char* blit_kernel_name();
@@ -0,0 +1,26 @@
+// StreamFormat.h: Keeps the formatting of a report from leaking into its stream.
+
+#pragma once
+
+#include <ios>
+
+// Saves the flags and precision of a stream and puts them back when it goes
+// out of scope, so a report can use std::fixed and std::setprecision freely
+class StreamFormatGuard {
+private:
+  std::ios_base& stream;
+  std::ios_base::fmtflags flags;
+  std::streamsize precision;
+public:
+  explicit StreamFormatGuard(std::ios_base& s)
+    : stream(s), flags(s.flags()), precision(s.precision())
+  {
+  }
+  ~StreamFormatGuard()
+  {
+    stream.flags(flags);
+    stream.precision(precision);
+  }
+  StreamFormatGuard(const StreamFormatGuard&) = delete;
+  StreamFormatGuard& operator=(const StreamFormatGuard&) = delete;
+};
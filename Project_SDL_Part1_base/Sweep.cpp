@@ -0,0 +1,182 @@
+// Sweep.cpp: Runs many headless worlds over a grid of parameters.
+//
+
+#include "Sweep.h"
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// Most values of one list, a typo in a range should not fill the memory
+constexpr size_t maxSweepValues = 1 << 20;
+
+// A value of a sweep list, between 0 and max
+uint64_t parse_sweep_value(const std::string& text, uint64_t max)
+{
+  size_t used = 0;
+  long long v = -1;
+  try
+  {
+    v = std::stoll(text, &used);
+  }
+  catch(const std::logic_error&)
+  {
+      //Not a number, v stays negative
+  }
+  if(v < 0 || used != text.size() || (uint64_t)v > max)
+    throw std::invalid_argument("parse_sweep_values(): " + text + " is not a value from 0 to " +
+                                std::to_string(max));
+  return (uint64_t)v;
+}
+} // namespace
+
+std::vector<uint64_t> parse_sweep_values(const std::string& text, uint64_t max)
+{
+  std::vector<uint64_t> values;
+  std::stringstream items(text);
+  std::string item;
+  while(std::getline(items, item, ','))
+  {
+    size_t colon = item.find(':');
+    if(colon == std::string::npos)
+    {
+      values.push_back(parse_sweep_value(item, max));
+      continue;
+    }
+
+      //first:last, or first:last:step, last included
+    uint64_t first = parse_sweep_value(item.substr(0, colon), max);
+    std::string rest = item.substr(colon + 1);
+    size_t colon2 = rest.find(':');
+    uint64_t last = parse_sweep_value(rest.substr(0, colon2), max);
+    uint64_t step = colon2 == std::string::npos ? 1 : parse_sweep_value(rest.substr(colon2 + 1), max);
+    if(step == 0 || last < first)
+      throw std::invalid_argument("parse_sweep_values(): bad range " + item);
+    if(values.size() + (last - first) / step >= maxSweepValues)
+      throw std::invalid_argument("parse_sweep_values(): more than " + std::to_string(maxSweepValues) +
+                                  " values in " + item);
+      //Stops before v + step could wrap around
+    for(uint64_t v = first; ; v += step)
+    {
+      values.push_back(v);
+      if(last - v < step) break;
+    }
+  }
+  if(values.empty())
+    throw std::invalid_argument("parse_sweep_values(): no value in \"" + text + "\"");
+  return values;
+}
+
+SweepAxis parse_sweep_axis(const std::string& text)
+{
+  size_t equal = text.find('=');
+  if(equal == std::string::npos)
+    throw std::invalid_argument("parse_sweep_axis(): expected key=values, got " + text);
+    //The values end up in int parameters
+  const uint64_t maxValue = std::numeric_limits<int>::max();
+  SweepAxis axis{text.substr(0, equal), parse_sweep_values(text.substr(equal + 1), maxValue)};
+    //Fails now on a wrong name rather than in the middle of the sweep
+  get_param(SimParams(), axis.key);
+  return axis;
+}
+
+std::vector<SweepRun> run_sweep(const SweepGrid& grid, JobSystem& jobs)
+{
+    //Every combination of the axes, the last axis changes fastest
+  std::vector<SimParams> combos = {grid.params};
+  for(const SweepAxis& axis : grid.axes)
+  {
+    std::vector<SimParams> next;
+    for(const SimParams& base : combos)
+    {
+      for(uint64_t v : axis.values)
+      {
+        next.push_back(base);
+        set_param(next.back(), axis.key, (int)v);
+      }
+    }
+    combos = std::move(next);
+  }
+
+    //A ground throws on parameters out of range, on a worker thread that
+    //would terminate the program: every combination is checked first
+  std::string bad;
+  for(const SimParams& params : combos)
+  {
+    if(valid_params(params)) continue;
+    bad += "\n ";
+    for(const SweepAxis& axis : grid.axes)
+    {
+      bad += " " + axis.key + "=" + std::to_string(get_param(params, axis.key));
+    }
+  }
+  if(!bad.empty())
+    throw std::invalid_argument("run_sweep(): parameters out of range for" + bad);
+
+  std::vector<SweepRun> runs;
+  for(uint64_t sheep : grid.sheep)
+  {
+    for(uint64_t wolves : grid.wolves)
+    {
+      for(const SimParams& params : combos)
+      {
+        for(uint64_t seed : grid.seeds)
+        {
+          runs.push_back({sheep, wolves, seed, params, {}});
+        }
+      }
+    }
+  }
+
+  uint32_t ticks = (uint32_t)(grid.seconds * frame_rate);
+  unsigned every = grid.sampleTicks > 0 ? grid.sampleTicks : 1;
+
+    //A world per job, each one writes only its own run
+  jobs.parallel_for(runs.size(), 1, [&](size_t begin, size_t end) {
+    for(size_t r = begin; r < end; ++r)
+    {
+      SweepRun& run = runs[r];
+        //Headless, the world has no sprites and no job system of its own
+      ground world(NULL, run.seed, run.params);
+      world.populate(run.sheep, run.wolves);
+      run.samples.reserve(ticks / every + 2);
+
+      auto sample = [&]() {
+        run.samples.push_back({world.getClock().tick, (uint32_t)world.sheep_count(),
+                               (uint32_t)world.wolf_count()});
+      };
+      sample();
+      for(uint32_t t = 1; t <= ticks; ++t)
+      {
+        world.update();
+        if(t % every == 0 || t == ticks) sample();
+      }
+    }
+  });
+  return runs;
+}
+
+void write_sweep_csv(const std::vector<SweepRun>& runs, const std::vector<SweepAxis>& axes,
+                     std::ostream& out)
+{
+  out << "run,seed,n_sheep,n_wolf,";
+  for(const SweepAxis& axis : axes)
+  {
+    out << axis.key << ',';
+  }
+  out << "tick,seconds,sheep,wolves\n";
+  for(size_t r = 0; r < runs.size(); ++r)
+  {
+    const SweepRun& run = runs[r];
+    for(const SweepRun::Sample& s : run.samples)
+    {
+      out << r << ',' << run.seed << ',' << run.sheep << ',' << run.wolves << ',';
+      for(const SweepAxis& axis : axes)
+      {
+        out << get_param(run.params, axis.key) << ',';
+      }
+      out << s.tick << ',' << s.tick * frame_time << ',' << s.sheep << ',' << s.wolves << '\n';
+    }
+  }
+}
@@ -0,0 +1,60 @@
+// Sweep.h: Runs many headless worlds over a grid of parameters.
+
+#pragma once
+
+#include "JobSystem.h"
+#include "Project_SDL1.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Values of a sweep parameter: "a,b,c", a range "a:b" or a stepped range "a:b:step"
+// Throws std::invalid_argument if text is not one of them, if a value is
+// not in [0, max] or if a range has more than about a million values
+std::vector<uint64_t> parse_sweep_values(const std::string& text, uint64_t max);
+
+// A simulation parameter taking every one of values
+struct SweepAxis {
+  std::string key;
+  std::vector<uint64_t> values;
+};
+
+// An axis "key=V", V as in parse_sweep_values(), up to the largest int
+// Throws std::invalid_argument if key is not a parameter name
+SweepAxis parse_sweep_axis(const std::string& text);
+
+// Every combination of the values is run once per seed
+struct SweepGrid {
+  std::vector<uint64_t> sheep;
+  std::vector<uint64_t> wolves;
+  std::vector<uint64_t> seeds;
+  // Parameters of every world, then each axis overrides its own key
+  SimParams params;
+  std::vector<SweepAxis> axes;
+  // Simulated time of every run
+  unsigned seconds = 60;
+  // Populations are sampled every sampleTicks steps of the clock
+  unsigned sampleTicks = 60;
+};
+
+// One world of the sweep and its population curve
+struct SweepRun {
+  uint64_t sheep, wolves, seed;
+  SimParams params;
+  // Clock tick, sheep and wolves at each sample, the last one is the end
+  struct Sample { uint32_t tick, sheep, wolves; };
+  std::vector<Sample> samples;
+};
+
+// Runs every world of grid, one world per job, spread over jobs.
+// Each world runs on a single thread, the results do not depend on the
+// number of threads.
+// Throws std::invalid_argument, before running anything, listing the
+// combinations of the axes whose parameters are out of range
+std::vector<SweepRun> run_sweep(const SweepGrid& grid, JobSystem& jobs);
+
+// One line per sample: run,seed,n_sheep,n_wolf, the keys of axes,
+// then tick,seconds,sheep,wolves
+void write_sweep_csv(const std::vector<SweepRun>& runs, const std::vector<SweepAxis>& axes,
+                     std::ostream& out);
@@ -0,0 +1,74 @@
+// SystemScheduler.cpp: Runs each system of the ground at its own rate.
+//
+
+#include "SystemScheduler.h"
+#include "StreamFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+SystemScheduler::SystemScheduler(double stepRate)
+  : stepRate(stepRate)
+{
+}
+
+SystemScheduler::Id SystemScheduler::add(const std::string& name, double hz)
+{
+  systems.push_back({name, hz, 1, 0, false, 0, 0});
+  schedule(systems.size() - 1);
+  return systems.size() - 1;
+}
+
+void SystemScheduler::setRate(Id id, double hz)
+{
+  systems[id].hz = hz;
+  schedule(id);
+}
+
+void SystemScheduler::schedule(size_t id)
+{
+  System& s = systems[id];
+  s.offset = 0;
+  if(s.hz <= on_demand)
+  {
+    s.period = 0;
+    return;
+  }
+  s.period = std::max<uint32_t>(1, (uint32_t)std::lround(stepRate / s.hz));
+
+    //Count the other systems running on each step of the period
+    //and take the step with the fewest
+  std::vector<uint32_t> load(s.period, 0);
+  for(size_t other = 0; other < systems.size(); ++other)
+  {
+    const System& o = systems[other];
+    if(other == id || o.period <= 1) continue;
+    for(uint32_t t = 0; t < s.period; ++t)
+    {
+      if((t + o.offset) % o.period == 0) ++load[t];
+    }
+  }
+    //Running on step t means (t + offset) % period == 0
+  uint32_t best = std::min_element(load.begin(), load.end()) - load.begin();
+  s.offset = (s.period - best) % s.period;
+}
+
+void SystemScheduler::report(std::ostream& out) const
+{
+  StreamFormatGuard guard(out);
+  double frequency = (double)SDL_GetPerformanceFrequency();
+  double seconds = steps / stepRate;
+  out << "Systems over " << steps << " steps\n";
+  out << "system            rate Hz     runs  us/run  us/sim s\n";
+  for(const System& s : systems)
+  {
+    double us = s.ticks * 1e6 / frequency;
+    out << std::left << std::setw(16) << s.name << std::right << std::fixed << std::setprecision(1);
+    if(s.period == 0) out << std::setw(9) << "demand";
+    else out << std::setw(9) << stepRate / s.period;
+    out << std::setw(9) << s.runs
+        << std::setw(8) << (s.runs ? us / s.runs : 0.0)
+        << std::setw(10) << (seconds > 0.0 ? us / seconds : 0.0) << '\n';
+  }
+}
@@ -0,0 +1,76 @@
+// SystemScheduler.h: Runs each system of the ground at its own rate.
+
+#pragma once
+
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Systems run every step, a number of times per second of simulation, or
+// only when requested. A system at a lower rate runs every `period` steps,
+// on the step of its period the fewest other systems run on, so that the
+// slow systems do not all land on the same step.
+// The time spent in each system is measured on every run.
+class SystemScheduler {
+private:
+  struct System {
+    std::string name;
+    double hz;
+    // Runs when (tick + offset) % period == 0, period 0 when on demand
+    uint32_t period;
+    uint32_t offset;
+    bool requested;
+    uint64_t runs;
+    Uint64 ticks;
+  };
+  double stepRate;
+  std::vector<System> systems;
+  uint64_t steps = 0;
+
+  // Sets the period and picks the least loaded offset of system id
+  void schedule(size_t id);
+public:
+  using Id = size_t;
+  // Rate of a system that only runs when requested
+  static constexpr double on_demand = 0.0;
+
+  // stepRate: steps per second of simulation
+  explicit SystemScheduler(double stepRate);
+
+  // Adds a system running hz times per second, on every step when hz is
+  // the step rate or more, on_demand to run it only after request()
+  Id add(const std::string& name, double hz);
+  void setRate(Id id, double hz);
+  double rate(Id id) const { return systems[id].hz; }
+
+  // Counts a step of the simulation, for the report
+  void next_step() { ++steps; }
+
+  // The on demand system id runs at its next run()
+  void request(Id id) { systems[id].requested = true; }
+  bool due(Id id, uint32_t tick) const
+  {
+    const System& s = systems[id];
+    if(s.period == 0) return s.requested;
+    return (tick + s.offset) % s.period == 0;
+  }
+
+  // Calls f() if system id is due at tick, and adds its time to the system
+  template <class F>
+  void run(Id id, uint32_t tick, F&& f)
+  {
+    if(!due(id, tick)) return;
+    System& s = systems[id];
+    Uint64 start = SDL_GetPerformanceCounter();
+    f();
+    s.ticks += SDL_GetPerformanceCounter() - start;
+    ++s.runs;
+    s.requested = false;
+  }
+
+  // Rate, runs, time per run and per second of simulation of every system
+  void report(std::ostream& out) const;
+};
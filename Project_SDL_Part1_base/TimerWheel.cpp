@@ -0,0 +1,130 @@
+// TimerWheel.cpp: Fires deadlines counted in steps of the simulation clock.
+//
+
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(uint32_t now)
+{
+  reset(now);
+}
+
+void TimerWheel::reset(uint32_t now)
+{
+  for(Node& n : nodes)
+  {
+    n.slot = none;
+  }
+  heads.fill(none);
+  next = now + 1;
+  count = 0;
+}
+
+void TimerWheel::resize(size_t n)
+{
+  if(n > nodes.size()) nodes.resize(n, Node{0, none, none, none});
+}
+
+void TimerWheel::schedule(Id id, uint32_t deadline)
+{
+  if(armed(id)) unlink(id);
+  nodes[id].deadline = deadline;
+  link(id);
+  ++count;
+}
+
+void TimerWheel::cancel(Id id)
+{
+  if(armed(id)) unlink(id);
+}
+
+void TimerWheel::move(Id from, Id to)
+{
+  if(!armed(from)) return;
+  Node& n = nodes[to];
+  n = nodes[from];
+  if(n.prev == none) heads[n.slot] = to;
+  else nodes[n.prev].next = to;
+  if(n.next != none) nodes[n.next].prev = to;
+  nodes[from].slot = none;
+}
+
+void TimerWheel::link(Id id)
+{
+  Node& n = nodes[id];
+  uint32_t delta = n.deadline - next;
+    //A deadline already past fires at the next step, one too far waits in
+    //the last wheel and is placed again when its slot comes
+  if((int32_t)delta < 0) delta = 0;
+  if(delta > maxDelta) delta = maxDelta;
+  uint32_t at = next + delta;
+
+  Id slot;
+  if(delta < rootSize)
+  {
+    slot = at & (rootSize - 1);
+  }
+  else
+  {
+      //The first wheel whose turn covers the delta
+    int level = 1;
+    int shift = rootBits;
+    while(delta >= (1u << (shift + levelBits)))
+    {
+      ++level;
+      shift += levelBits;
+    }
+    slot = rootSize + (level - 1) * levelSize + ((at >> shift) & (levelSize - 1));
+  }
+
+  n.slot = slot;
+  n.prev = none;
+  n.next = heads[slot];
+  if(n.next != none) nodes[n.next].prev = id;
+  heads[slot] = id;
+}
+
+void TimerWheel::unlink(Id id)
+{
+  Node& n = nodes[id];
+  if(n.prev == none) heads[n.slot] = n.next;
+  else nodes[n.prev].next = n.next;
+  if(n.next != none) nodes[n.next].prev = n.prev;
+  n.slot = none;
+  --count;
+}
+
+void TimerWheel::take_slot(Id from, Id to)
+{
+  heads[to] = heads[from];
+  heads[from] = none;
+  for(Id id = heads[to]; id != none; id = nodes[id].next)
+  {
+    nodes[id].slot = to;
+  }
+}
+
+void TimerWheel::turn()
+{
+  uint32_t step = next;
+    //A wheel back to its first slot spreads the current slot of the next
+    //wheel over the ones below, their deadlines are now within its turn
+  uint32_t index = step & (rootSize - 1);
+  int shift = rootBits;
+  for(int level = 1; level < levels && index == 0; ++level)
+  {
+    index = (step >> shift) & (levelSize - 1);
+    Id slot = rootSize + (level - 1) * levelSize + index;
+    Id id = heads[slot];
+    heads[slot] = none;
+    while(id != none)
+    {
+      Id after = nodes[id].next;
+      link(id);
+      id = after;
+    }
+    shift += levelBits;
+  }
+
+  take_slot(step & (rootSize - 1), firing);
+  ++next;
+}
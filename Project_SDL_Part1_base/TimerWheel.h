@@ -0,0 +1,147 @@
+// TimerWheel.h: Fires deadlines counted in steps of the simulation clock.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel. Each id [0, size()[ holds at most one timer,
+// for example the deadline of the animal in that slot of a pool.
+// A timer is a node of a doubly linked list, one list per slot of the
+// wheels, so schedule() and cancel() are O(1). The first wheel has a slot
+// for each of the next 256 steps, each wheel after it 64 slots as long as
+// a whole turn of the previous one. When a wheel comes back to its first
+// slot, the current slot of the next wheel is spread over the wheels below.
+// advance() costs O(1) per step plus the timers it fires or moves down,
+// whatever the number of timers waiting.
+class TimerWheel {
+public:
+  using Id = uint32_t;
+  static constexpr Id none = UINT32_MAX;
+
+  // The steps up to now are past, the first advance() goes through now + 1
+  explicit TimerWheel(uint32_t now = 0);
+
+  // Cancels every timer, the steps up to now are past
+  void reset(uint32_t now);
+  // The ids [0, n[ can hold a timer, the wheel never shrinks
+  void resize(size_t n);
+  size_t size() const { return nodes.size(); }
+
+  // Sets the timer of id to fire at the step deadline, replacing the one it
+  // had. A deadline already past fires at the next step.
+  void schedule(Id id, uint32_t deadline);
+  // Removes the timer of id, if it has one
+  void cancel(Id id);
+  bool armed(Id id) const { return nodes[id].slot != none; }
+  uint32_t deadline(Id id) const { return nodes[id].deadline; }
+  // The timer of from, if any, becomes the timer of to, which has none
+  void move(Id from, Id to);
+  // Number of timers waiting
+  size_t pending() const { return count; }
+
+  // Goes through the steps up to now and calls fire(id) for each timer
+  // whose deadline is reached, once it is removed. fire may schedule or
+  // cancel any timer.
+  template <class F>
+  void advance(uint32_t now, F&& fire)
+  {
+    while((int32_t)(now - next) >= 0)
+    {
+      turn();
+      while(heads[firing] != none)
+      {
+        Id id = heads[firing];
+        unlink(id);
+        fire(id);
+      }
+    }
+  }
+private:
+  static constexpr int rootBits = 8;
+  static constexpr int levelBits = 6;
+  static constexpr int levels = 4;
+  static constexpr uint32_t rootSize = 1u << rootBits;
+  static constexpr uint32_t levelSize = 1u << levelBits;
+  // Farthest step the wheels reach, later timers wait in the last wheel
+  // and are placed again when their slot comes
+  static constexpr uint32_t maxDelta = (1u << (rootBits + (levels - 1) * levelBits)) - 1;
+  // Slot of the timers being fired by advance()
+  static constexpr Id firing = rootSize + (levels - 1) * levelSize;
+
+  struct Node {
+    uint32_t deadline;
+    // Neighbours in the list of the slot, none at the ends
+    Id prev, next;
+    // Slot of the list, none when not armed
+    Id slot;
+  };
+  std::vector<Node> nodes;
+  // First node of each slot: the first wheel, the next ones, then firing
+  std::array<Id, firing + 1> heads;
+  // Next step advance() goes through
+  uint32_t next;
+  size_t count = 0;
+
+  // Puts armed node id in the slot of its deadline
+  void link(Id id);
+  // Takes node id out of its slot, it is no longer armed
+  void unlink(Id id);
+  // Moves every node of slot from to slot to, which is empty
+  void take_slot(Id from, Id to);
+  // Spreads the upper slots reaching the next step, moves the timers of
+  // that step to the firing slot and counts the step
+  void turn();
+};
+
+// Set of ids [0, n[ with O(1) insert, erase and move, stored densely so
+// that going through it costs its size and not n. Holds the entities whose
+// timer fired and that wait for a system to handle them.
+class SlotSet {
+private:
+  std::vector<uint32_t> items;
+  // Index of each id in items, TimerWheel::none when absent
+  std::vector<uint32_t> where;
+public:
+  // The ids [0, n[ can be inserted, the set never shrinks
+  void resize(size_t n)
+  {
+    if(n > where.size()) where.resize(n, TimerWheel::none);
+  }
+  void clear()
+  {
+    for(uint32_t id : items) where[id] = TimerWheel::none;
+    items.clear();
+  }
+  bool contains(uint32_t id) const { return where[id] != TimerWheel::none; }
+  void insert(uint32_t id)
+  {
+    if(contains(id)) return;
+    where[id] = items.size();
+    items.push_back(id);
+  }
+  void erase(uint32_t id)
+  {
+    if(!contains(id)) return;
+      //The last item takes the place of the erased one
+    uint32_t last = items.back();
+    items[where[id]] = last;
+    where[last] = where[id];
+    items.pop_back();
+    where[id] = TimerWheel::none;
+  }
+  // Id from, if present, is replaced by to, which is absent
+  void move(uint32_t from, uint32_t to)
+  {
+    if(!contains(from)) return;
+    items[where[from]] = to;
+    where[to] = where[from];
+    where[from] = TimerWheel::none;
+  }
+  bool empty() const { return items.empty(); }
+  size_t size() const { return items.size(); }
+  // The ids in no particular order
+  const std::vector<uint32_t>& ids() const { return items; }
+};
@@ -0,0 +1,48 @@
+// TripleBuffer.h: Hands the latest value from one thread to another without locks.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// One writer thread fills a buffer and publishes it, one reader thread
+// takes the last published one. Neither ever waits for the other: the
+// writer always has a free buffer, the reader keeps its buffer until it
+// asks for a newer one. A buffer is not touched by the writer while the
+// reader holds it, so what the reader sees is never torn.
+// Buffers are reused, their capacity stays from one value to the next.
+template <class T>
+class TripleBuffer {
+private:
+  static constexpr uint8_t indexMask = 3;
+  // Set on the middle buffer when it holds a value the reader has not taken
+  static constexpr uint8_t freshBit = 4;
+
+  std::array<T, 3> buffers;
+  // Buffer between the two threads, with freshBit
+  std::atomic<uint8_t> middle{1};
+  // Owned by the writer
+  uint8_t back = 0;
+  // Owned by the reader
+  uint8_t front = 2;
+public:
+  // Writer: the buffer to fill, it may hold an old value
+  T& write_buffer() { return buffers[back]; }
+  // Writer: hands the filled buffer to the reader and takes a free one
+  void publish()
+  {
+    back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+  }
+
+  // Reader: takes the last published buffer if it did not have it yet,
+  // returns whether read_buffer() changed
+  bool update()
+  {
+    if(!(middle.load(std::memory_order_relaxed) & freshBit)) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+    return true;
+  }
+  // Reader: the buffer taken by the last update()
+  const T& read_buffer() const { return buffers[front]; }
+};
@@ -1,28 +1,197 @@
 #include "Project_SDL1.h"
+#include "Sweep.h"
+#include <fstream>
+#include <limits>
 #include <stdio.h>
 #include <string>
 #include <time.h>
+#include <vector>
 
 int main(int argc, char* argv[]) {
 
-  //Randomize
-  std::srand(time(NULL));
   std::cout << "Starting up the application" << std::endl;
 
-  if (argc != 4)
+  //Options start with "--", everything else is a positional argument
+  std::vector<std::string> args;
+  bool headless = false;
+  unsigned speed = 1;
+  unsigned threads = 0;
+  bool profile = false;
+  bool overlay = false;
+  bool renderThread = false;
+  std::string profileCsv;
+  LogLevel logLevel = LogLevel::Info;
+  std::string loadPath, savePath;
+  std::string recordPath, replayPath;
+  //Tuning values, a file first then the single values on top of it
+  SimParams params;
+  std::string paramsPath;
+  std::vector<std::string> paramArgs;
+  //Sweep mode: many headless worlds instead of one run
+  std::string sweepPath;
+  SweepGrid grid;
+  //Random by default, pass the printed seed to --seed to replay a run
+  uint64_t seed = time(NULL);
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--headless")
+      headless = true;
+    else if (arg == "--speed" && i + 1 < argc)
+      speed = std::stoul(argv[++i]);
+    else if (arg == "--threads" && i + 1 < argc)
+      threads = std::stoul(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = std::stoull(argv[++i]);
+    else if (arg == "--profile")
+      profile = true;
+    else if (arg == "--profile-csv" && i + 1 < argc) {
+      profile = true;
+      profileCsv = argv[++i];
+    }
+    else if (arg == "--overlay")
+      profile = overlay = true;
+    else if (arg == "--render-thread")
+      renderThread = true;
+    else if (arg == "--log-level" && i + 1 < argc)
+      logLevel = log_level_from_name(argv[++i]);
+    else if (arg == "--load" && i + 1 < argc)
+      loadPath = argv[++i];
+    else if (arg == "--save" && i + 1 < argc)
+      savePath = argv[++i];
+    else if (arg == "--record" && i + 1 < argc)
+      recordPath = argv[++i];
+    else if (arg == "--replay" && i + 1 < argc)
+      replayPath = argv[++i];
+    else if (arg == "--params" && i + 1 < argc)
+      paramsPath = argv[++i];
+    else if (arg == "--param" && i + 1 < argc)
+      paramArgs.push_back(argv[++i]);
+    else if (arg == "--vary" && i + 1 < argc)
+      grid.axes.push_back(parse_sweep_axis(argv[++i]));
+    else if (arg == "--sweep" && i + 1 < argc)
+      sweepPath = argv[++i];
+    else if (arg == "--sheep" && i + 1 < argc)
+      grid.sheep = parse_sweep_values(argv[++i], std::numeric_limits<unsigned>::max());
+    else if (arg == "--wolves" && i + 1 < argc)
+      grid.wolves = parse_sweep_values(argv[++i], std::numeric_limits<unsigned>::max());
+    else if (arg == "--seeds" && i + 1 < argc)
+      grid.seeds = parse_sweep_values(argv[++i], std::numeric_limits<int64_t>::max());
+    else if (arg == "--seconds" && i + 1 < argc)
+      grid.seconds = std::stoul(argv[++i]);
+    else if (arg == "--sample" && i + 1 < argc)
+      grid.sampleTicks = std::stoul(argv[++i]);
+    else
+      args.push_back(arg);
+  }
+
+  Logger::instance().setLevel(logLevel);
+
+  if (!paramsPath.empty())
+    load_params(params, paramsPath);
+  for (const std::string& assignment : paramArgs)
+    parse_param(params, assignment);
+  grid.params = params;
+
+  if (!sweepPath.empty()) {
+    if (grid.sheep.empty() || grid.wolves.empty() || grid.seeds.empty())
+      throw std::runtime_error("--sweep needs --sheep, --wolves and --seeds");
+    std::ofstream csv(sweepPath);
+    if (!csv)
+      throw std::runtime_error("Cannot write " + sweepPath);
+
+    init(true);
+    JobSystem jobs(threads);
+    size_t worlds = grid.sheep.size() * grid.wolves.size() * grid.seeds.size();
+    for (const SweepAxis& axis : grid.axes)
+      worlds *= axis.values.size();
+    std::cout << "Sweep of " << worlds << " worlds on " << jobs.size() << " threads" << std::endl;
+    write_sweep_csv(run_sweep(grid, jobs), grid.axes, csv);
+    std::cout << "Sweep written to " << sweepPath << std::endl;
+    return 0;
+  }
+
+  //The world loaded before the run, a replay has to start from the same one
+  uint64_t snapshotHash = loadPath.empty() ? 0 : snapshot_file_hash(loadPath);
+
+  //A replay brings its own seed, animals and parameters, and runs headless
+  std::unique_ptr<InputReplay> replay;
+  if (!replayPath.empty()) {
+    replay = std::make_unique<InputReplay>(replayPath);
+    headless = true;
+    const RecordingHeader& recorded = replay->header();
+    seed = recorded.seed;
+    SimParams recordedParams = params_from_values(recorded.params);
+    //Parameters given on the command line must be the recorded ones
+    if ((!paramsPath.empty() || !paramArgs.empty()) && !(params == recordedParams))
+      throw std::runtime_error("--replay: the parameters differ from the ones of the recording");
+    params = recordedParams;
+    if (recorded.snapshotHash != snapshotHash)
+      throw std::runtime_error(recorded.snapshotHash == 0
+        ? "--replay: the recording did not start from a --load snapshot"
+        : "--replay: pass the --load snapshot the recording started from");
+  }
+
+  if (args.size() != 3 && !(replay && args.empty()))
     throw std::runtime_error("Need three arguments - "
                              "number of sheep, number of wolves, "
-                             "simulation time\n");
+                             "simulation time\n"
+                             "Options: --headless (no window)\n"
+                             "         --speed N (N simulation steps per frame)\n"
+                             "         --seed N (seed of the simulation)\n"
+                             "         --threads N (simulation threads, 0 for all cores)\n"
+                             "         --profile (time the phases of the frames)\n"
+                             "         --profile-csv FILE (write the timing of every frame)\n"
+                             "         --overlay (draw the phase timings in the window)\n"
+                             "         --render-thread (simulate on a worker thread, draw on the main one)\n"
+                             "         --log-level L (trace, debug, info, warn, error or off)\n"
+                             "         --load FILE (start from a saved world)\n"
+                             "         --save FILE (save the world at the end)\n"
+                             "         --record FILE (write the inputs of the run)\n"
+                             "         --replay FILE (run a recording headless with its seed, animals and\n"
+                             "                        parameters, no arguments needed; pass the same --load)\n"
+                             "         --params FILE (simulation parameters, one key = value per line)\n"
+                             "         --param KEY=N (set one simulation parameter, after --params)\n"
+                             "Sweep:   --sweep FILE --sheep V --wolves V --seeds V [--seconds N] [--sample TICKS]\n"
+                             "                  [--vary KEY=V]...\n"
+                             "         runs every combination headless on --threads and writes\n"
+                             "         the populations to FILE, V is a,b,c or first:last[:step]\n"
+                             "Parameters: sheepSpeed wolfSpeed dogSpeed huntDistance interactDistance\n"
+                             "            breedMs starveMs maxAnimals frameBoundary breedHz\n");
 
-  init();
+  init(headless);
 
   std::cout << "Done with initilization" << std::endl;
+  std::cout << "Seed: " << seed << std::endl;
+  if (!(params == SimParams()))
+    std::cout << "Custom simulation parameters" << std::endl;
+
+  unsigned n_sheep = replay ? replay->header().sheep : std::stoul(args[0]);
+  unsigned n_wolf = replay ? replay->header().wolves : std::stoul(args[1]);
+  unsigned period = replay ? 0 : std::stoul(args[2]);
+
+  application my_app(n_sheep, n_wolf, seed, headless, params);
+  my_app.setFastForward(speed);
+  my_app.setThreads(threads);
+  my_app.setRenderThread(renderThread);
+  if (profile)
+    my_app.setProfiling(profileCsv, overlay);
+  if (!loadPath.empty())
+    my_app.load(loadPath);
+  if (!recordPath.empty())
+    my_app.setRecording(recordPath, {seed, n_sheep, n_wolf, 0, snapshotHash, param_values(params)});
+  if (replay)
+    my_app.setReplay(std::move(replay));
 
-  application my_app(std::stoul(argv[1]), std::stoul(argv[2]));
+  std::cout << (headless ? "Running headless" : "Created window") << std::endl;
+  std::cout << "Movement kernel: " << move_kernel_name() << std::endl;
+  std::cout << "Nearest kernel: " << nearest_kernel_name() << std::endl;
+  if (!headless)
+    std::cout << "Sprite blitter: " << blit_kernel_name() << std::endl;
 
-  std::cout << "Created window" << std::endl;
+  int retval = my_app.loop(period);
 
-  int retval = my_app.loop(std::stoul(argv[3]));
+  if (!savePath.empty())
+    my_app.save(savePath);
 
   std::cout << "Exiting application with code " << retval << std::endl;
 
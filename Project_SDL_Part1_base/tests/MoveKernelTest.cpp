@@ -0,0 +1,115 @@
+// MoveKernelTest.cpp: Checks that the SIMD move kernels match the scalar results.
+//
+
+#include "../MoveKernel.h"
+
+#include <SDL.h>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const char* what, const char* kernel, size_t n, int speed, int step, size_t i)
+{
+  if(ok) return;
+  ++failures;
+  if(failures <= 20)
+    std::printf("FAIL %s (%s) n=%zu speed=%d step=%d animal=%zu\n", what, kernel, n, speed, step, i);
+}
+
+// Columns of n animals, owning what MoveColumns points to
+struct Animals {
+  std::vector<int> x, y, xSpeed, ySpeed;
+  std::vector<SplitMix64> rng;
+
+  MoveColumns columns()
+  {
+    return {x.data(), y.data(), xSpeed.data(), ySpeed.data(), rng.data()};
+  }
+};
+
+// A coordinate inside of [min, max], on one of its edges or past it
+int edge_coord(std::mt19937& gen, int min, int max)
+{
+  const int offsets[] = {-3, -1, 0, 1};
+  int offset = offsets[gen() % 4];
+  switch(gen() % 3)
+  {
+  case 0: return min + offset;
+  case 1: return max - offset;
+  default: return min + (int)(gen() % (max - min + 1));
+  }
+}
+
+// Every kernel set against the scalar one on the same columns, every count
+// up to two AVX2 widths so the tails are covered, the animals on and past
+// every edge of the box so each axis bounces both ways
+void test_kernels(std::mt19937& gen)
+{
+  std::vector<MoveKernelSet> sets = move_kernel_sets();
+  std::printf("kernels:");
+  for(const MoveKernelSet& set : sets) std::printf(" %s", set.name);
+  std::printf("\n");
+
+  const BounceBox box = {10, 20, 90, 60};
+  for(int speed = 1; speed <= 4; ++speed)
+  {
+    std::uniform_int_distribution<int> speeds(-speed, speed);
+    for(size_t n = 0; n <= 17; ++n)
+    {
+      for(int round = 0; round < 50; ++round)
+      {
+        Animals start;
+        for(size_t i = 0; i < n; ++i)
+        {
+          start.x.push_back(edge_coord(gen, box.minX, box.maxX));
+          start.y.push_back(edge_coord(gen, box.minY, box.maxY));
+          start.xSpeed.push_back(speeds(gen));
+          start.ySpeed.push_back(speeds(gen));
+          start.rng.push_back({((uint64_t)gen() << 32) | gen()});
+        }
+
+        std::vector<Animals> moved(sets.size(), start);
+        for(int step = 0; step < 8; ++step)
+        {
+          for(size_t s = 0; s < sets.size(); ++s)
+          {
+            sets[s].move(moved[s].columns(), n, speed, box);
+          }
+            //The scalar kernel is the reference
+          const Animals& want = moved[0];
+          for(size_t s = 1; s < sets.size(); ++s)
+          {
+            const Animals& got = moved[s];
+            for(size_t i = 0; i < n; ++i)
+            {
+              check(got.x[i] == want.x[i] && got.y[i] == want.y[i], "position", sets[s].name, n, speed, step, i);
+              check(got.xSpeed[i] == want.xSpeed[i] && got.ySpeed[i] == want.ySpeed[i], "speed",
+                    sets[s].name, n, speed, step, i);
+              check(got.rng[i].state == want.rng[i].state, "stream", sets[s].name, n, speed, step, i);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  (void)argc;
+  (void)argv;
+  std::mt19937 gen(12345);
+  test_kernels(gen);
+  if(failures > 0)
+  {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+  std::printf("all the kernels match\n");
+  return 0;
+}
@@ -0,0 +1,151 @@
+// NearestKernelTest.cpp: Checks that the SIMD nearest kernels and the grid match the scalar results.
+//
+
+#include "../NearestKernel.h"
+#include "../SpatialGrid.h"
+
+#include <SDL.h>
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void check(bool ok, const char* what, const char* kernel, size_t n, int x, int y)
+{
+  if(ok) return;
+  ++failures;
+  if(failures <= 20)
+    std::printf("FAIL %s (%s) n=%zu query=(%d,%d)\n", what, kernel, n, x, y);
+}
+
+// Every kernel set against the scalar one on the same points, every count
+// up to a few SIMD widths so the tails are covered. The coordinates are in
+// a small range so many points are at the same distance.
+void test_kernels(std::mt19937& gen)
+{
+  std::vector<NearestKernelSet> sets = nearest_kernel_sets();
+  const NearestKernelSet& scalar = sets[0];
+  std::printf("kernels:");
+  for(const NearestKernelSet& set : sets) std::printf(" %s", set.name);
+  std::printf("\n");
+
+  for(int spread : {4, 40, 1000})
+  {
+    std::uniform_int_distribution<int> coord(-spread, spread);
+    for(size_t n = 0; n <= 37; ++n)
+    {
+      for(int round = 0; round < 200; ++round)
+      {
+        std::vector<int> px(n), py(n);
+        std::vector<uint32_t> id(n);
+        for(size_t k = 0; k < n; ++k)
+        {
+          px[k] = coord(gen);
+          py[k] = coord(gen);
+          id[k] = gen() % 1000;
+        }
+        int x = coord(gen);
+        int y = coord(gen);
+        int limit2 = (int)(gen() % (2 * spread * spread + 1));
+        if(round == 0) limit2 = 0;
+
+        NearestHit want = scalar.nearest(px.data(), py.data(), n, x, y);
+        int wantId = scalar.within(px.data(), py.data(), id.data(), n, x, y, limit2);
+        if(n == 0)
+        {
+          check(want.pos == -1 && want.dist2 == INT_MAX, "empty nearest", scalar.name, n, x, y);
+          check(wantId == INT32_MAX, "empty within", scalar.name, n, x, y);
+        }
+        for(const NearestKernelSet& set : sets)
+        {
+          NearestHit got = set.nearest(px.data(), py.data(), n, x, y);
+          check(got.pos == want.pos && got.dist2 == want.dist2, "nearest", set.name, n, x, y);
+          int gotId = set.within(px.data(), py.data(), id.data(), n, x, y, limit2);
+          check(gotId == wantId, "within", set.name, n, x, y);
+        }
+      }
+    }
+  }
+}
+
+// Linear scan keeping the first point with the smallest truncated distance
+GridHit scan(const std::vector<int>& x, const std::vector<int>& y, int qx, int qy)
+{
+  GridHit best{-1, INT_MAX};
+  for(size_t i = 0; i < x.size(); ++i)
+  {
+    int dx = x[i] - qx;
+    int dy = y[i] - qy;
+    int dist = std::sqrt(dx * dx + dy * dy);
+    if(dist < best.dist) best = {(int)i, dist};
+  }
+  return best;
+}
+
+// The grid against the linear scan, with empty grids, points clustered in a
+// few cells so most cells are empty, queries outside of the grid and
+// points outside of it clamped in the border cells
+void test_grid(std::mt19937& gen)
+{
+  const int width = 640, height = 480;
+  SpatialGrid grid(width, height, 50);
+  for(size_t n : {0, 1, 2, 7, 30, 200, 1000})
+  {
+    for(int layout = 0; layout < 3; ++layout)
+    {
+      std::vector<int> x(n), y(n);
+      std::uniform_int_distribution<int> cluster(0, 3);
+      for(size_t i = 0; i < n; ++i)
+      {
+        if(layout == 0)
+        {
+          x[i] = gen() % width;
+          y[i] = gen() % height;
+        }
+        else if(layout == 1)
+        {
+            //A few clusters, the same positions repeated
+          x[i] = 100 + 150 * cluster(gen) + gen() % 3;
+          y[i] = 80 + 100 * cluster(gen) + gen() % 3;
+        }
+        else
+        {
+          x[i] = (int)(gen() % (width + 200)) - 100;
+          y[i] = (int)(gen() % (height + 200)) - 100;
+        }
+      }
+      grid.build(x, y);
+      for(int q = 0; q < 300; ++q)
+      {
+        int qx = (int)(gen() % (width + 400)) - 200;
+        int qy = (int)(gen() % (height + 400)) - 200;
+        GridHit want = scan(x, y, qx, qy);
+        GridHit got = grid.nearest(qx, qy);
+        check(got.index == want.index && (n == 0 || got.dist == want.dist), "grid nearest",
+              nearest_kernel_name(), n, qx, qy);
+      }
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  (void)argc;
+  (void)argv;
+  std::mt19937 gen(12345);
+  test_kernels(gen);
+  test_grid(gen);
+  if(failures > 0)
+  {
+    std::printf("%d failures\n", failures);
+    return 1;
+  }
+  std::printf("all the kernels match\n");
+  return 0;
+}